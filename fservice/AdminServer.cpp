@@ -0,0 +1,161 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/AdminServer.h>
+
+#include <fservice/ThreadPlacement.h>
+
+#include <grpcpp/alarm.h>
+
+#include <chrono>
+#include <exception>
+
+namespace fservice {
+
+template <typename Request, typename Reply>
+class AdminServer::CallData final : public ICompletionTag {
+ public:
+  using Responder = grpc::ServerAsyncResponseWriter<Reply>;
+
+  using RequestMethod = void (Admin::AsyncService::*)(
+      grpc::ServerContext*,
+      Request*,
+      Responder*,
+      grpc::CompletionQueue*,
+      grpc::ServerCompletionQueue*,
+      void*);
+
+  using HandleMethod = void (IAdminEventHandler::*)(Request const&, Reply&);
+
+  /* Create and request the next call of the method. */
+  static void arm(AdminServer& server,
+                  RequestMethod requestMethod,
+                  HandleMethod handleMethod) {
+    auto* callData = new CallData(server, requestMethod, handleMethod);
+    auto* completionQueue = server.completionQueue_.get();
+    (server.service_.*requestMethod)(&callData->context_,
+                                     &callData->request_,
+                                     &callData->responder_,
+                                     completionQueue,
+                                     completionQueue,
+                                     callData->tag());
+  }
+
+  void proceed(bool ok) override {
+    if (!ok || finished_) {
+      // Server is shutting down or the reply is sent.
+      delete this;
+      return;
+    }
+    if (!server_.stopping_.load(std::memory_order_relaxed)) {
+      arm(server_, requestMethod_, handleMethod_);
+    }
+
+    finished_ = true;
+    try {
+      (server_.adminEventHandler_.*handleMethod_)(request_, reply_);
+    } catch (std::exception const& error) {
+      LOG_ERRORF("Admin call failed: {}", error.what());
+      responder_.FinishWithError(
+          grpc::Status(grpc::StatusCode::INTERNAL, "Handler failed"), tag());
+      return;
+    }
+    responder_.Finish(reply_, grpc::Status::OK, tag());
+  }
+
+ private:
+  DECLARE_GET_LOGGER("AdminServer.CallData")
+
+  CallData(AdminServer& server,
+           RequestMethod requestMethod,
+           HandleMethod handleMethod)
+      : server_(server),
+        requestMethod_(requestMethod),
+        handleMethod_(handleMethod),
+        responder_(&context_) {
+  }
+
+  AdminServer& server_;
+
+  RequestMethod const requestMethod_;
+
+  HandleMethod const handleMethod_;
+
+  grpc::ServerContext context_;
+
+  Request request_;
+
+  Reply reply_;
+
+  Responder responder_;
+
+  /* Finish is called, the next completion is the last one. */
+  bool finished_ = false;
+};
+
+AdminServer::AdminServer(IAdminEventHandler& adminEventHandler)
+    : adminEventHandler_(adminEventHandler) {
+}
+
+AdminServer::~AdminServer() {
+  LOG_AUTO_TRACE();
+  shutdown();
+}
+
+void AdminServer::runAsync(std::string const& address) {
+  LOG_AUTO_TRACE();
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort(address, grpc::InsecureServerCredentials());
+  builder.RegisterService(&service_);
+  completionQueue_ = builder.AddCompletionQueue();
+  grpcServer_ = builder.BuildAndStart();
+  LOG_INFOF("Admin server listening on {}", address);
+  CallData<GetStatsRequest, StatsReply>::arm(
+      *this,
+      &Admin::AsyncService::RequestGetStats,
+      &IAdminEventHandler::onGetStats);
+  CallData<GetConfigRequest, ConfigReply>::arm(
+      *this,
+      &Admin::AsyncService::RequestGetConfig,
+      &IAdminEventHandler::onGetConfig);
+  CallData<ResetStatsRequest, ResetStatsReply>::arm(
+      *this,
+      &Admin::AsyncService::RequestResetStats,
+      &IAdminEventHandler::onResetStats);
+  thread_ = std::thread(&AdminServer::handleRpcs, this);
+}
+
+void AdminServer::shutdown() {
+  LOG_AUTO_TRACE();
+  if (grpcServer_ == nullptr) {
+    return;
+  }
+  stopping_.store(true, std::memory_order_relaxed);
+  // Admin calls are short, there is nothing worth waiting for.
+  grpcServer_->Shutdown(std::chrono::system_clock::now());
+  // Queue is shut down by its own thread, after the calls which were armed
+  // before stopping_ was seen.
+  grpc::Alarm alarm;
+  alarm.Set(completionQueue_.get(),
+            std::chrono::system_clock::now(),
+            stopTag_.tag());
+  thread_.join();
+  grpcServer_.reset();
+  LOG_INFO("Admin server stopped");
+}
+
+void AdminServer::handleRpcs() {
+  placeCurrentThread("AdminThread", {}, 0u, false);
+  void* tag;
+  bool ok;
+  while (completionQueue_->Next(&tag, &ok)) {
+    static_cast<ICompletionTag*>(tag)->proceed(ok);
+  }
+}
+
+void AdminServer::onStop(bool) {
+  completionQueue_->Shutdown();
+}
+
+} // namespace fservice
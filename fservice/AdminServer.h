@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <fservice/CompletionTag.h>
+#include <fservice/IAdminEventHandler.h>
+#include <fservice/Logger.h>
+
+#include <protos/Admin.grpc.pb.h>
+
+#include <grpcpp/grpcpp.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace fservice {
+
+/**
+ * Server of the Admin service. Has its own port, completion queue and
+ * thread, and handles calls right in that thread, so monitoring neither
+ * waits behind Greeter calls nor adds to their queues. Server stops on
+ * destruction.
+ */
+class AdminServer final {
+ public:
+  explicit AdminServer(IAdminEventHandler& adminEventHandler);
+
+  ~AdminServer();
+
+  AdminServer(AdminServer const&) = delete;
+  AdminServer& operator=(AdminServer const&) = delete;
+
+  /**
+   * Start listening. Non-blocking.
+   * @param address Address in "host:port" format.
+   */
+  void runAsync(std::string const& address);
+
+  /**
+   * Stop the server and its thread. Blocking.
+   */
+  void shutdown();
+
+ private:
+  DECLARE_GET_LOGGER("AdminServer")
+
+  /* Holds context of one call. Allocated per call and deletes itself once
+   * finished. */
+  template <typename Request, typename Reply>
+  class CallData;
+
+  /* Serve the queue until it is shut down. */
+  void handleRpcs();
+
+  /* Shut the queue down. Runs in the queue thread, so no call is armed on
+   * the queue after that. */
+  void onStop(bool ok);
+
+  IAdminEventHandler& adminEventHandler_;
+
+  Admin::AsyncService service_;
+
+  std::unique_ptr<grpc::ServerCompletionQueue> completionQueue_;
+
+  std::unique_ptr<grpc::Server> grpcServer_;
+
+  /* Set by shutdown. Finished calls stop arming new ones. */
+  std::atomic_bool stopping_{false};
+
+  MemberCompletionTag<AdminServer, &AdminServer::onStop> stopTag_{this};
+
+  std::thread thread_;
+};
+
+} // namespace fservice
@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/AdmissionController.h>
+
+namespace fservice {
+
+AdmissionController::AdmissionController(std::uint32_t maxInFlight,
+                                         AdmissionController* parent)
+    : maxInFlight_(maxInFlight), parent_(parent) {
+}
+
+bool AdmissionController::tryAcquire() {
+  auto const admitted = acquire();
+  (admitted ? accepted_ : shed_).fetch_add(1u, std::memory_order_relaxed);
+  return admitted;
+}
+
+void AdmissionController::release() {
+  inFlight_.fetch_sub(1u, std::memory_order_relaxed);
+  if (parent_ != nullptr) {
+    parent_->release();
+  }
+}
+
+std::uint64_t AdmissionController::getInFlight() const {
+  return inFlight_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t AdmissionController::getAccepted() const {
+  return accepted_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t AdmissionController::getShed() const {
+  return shed_.load(std::memory_order_relaxed);
+}
+
+bool AdmissionController::acquire() {
+  // Optimistic increment. Concurrent callers may see the limit exceeded for a
+  // moment and get rejected, which is fine for load shedding.
+  auto const inFlight = inFlight_.fetch_add(1u, std::memory_order_relaxed) + 1u;
+  if ((maxInFlight_ != 0u && inFlight > maxInFlight_) ||
+      (parent_ != nullptr && !parent_->acquire())) {
+    inFlight_.fetch_sub(1u, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+} // namespace fservice
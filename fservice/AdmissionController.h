@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace fservice {
+
+/**
+ * Bounds number of calls in flight. Controllers may be chained: a call is
+ * admitted only if the controller and all its parents are below their
+ * limits. Thread safe.
+ */
+class AdmissionController {
+ public:
+  /**
+   * Create controller.
+   * @param maxInFlight Limit of admitted calls. 0 means no limit.
+   * @param parent Controller which must admit the call as well. Optional.
+   */
+  explicit AdmissionController(std::uint32_t maxInFlight,
+                               AdmissionController* parent = nullptr);
+
+  AdmissionController(AdmissionController const&) = delete;
+  AdmissionController& operator=(AdmissionController const&) = delete;
+
+  /**
+   * Try to admit a call. Counts accepted and shed calls.
+   * @return True if admitted. Admitted call must be released.
+   */
+  bool tryAcquire();
+
+  /**
+   * Release admitted call.
+   */
+  void release();
+
+  std::uint64_t getInFlight() const;
+
+  /**
+   * Number of calls admitted by tryAcquire of this controller.
+   */
+  std::uint64_t getAccepted() const;
+
+  /**
+   * Number of calls rejected by tryAcquire of this controller.
+   */
+  std::uint64_t getShed() const;
+
+ private:
+  /* Admit without counting. */
+  bool acquire();
+
+  std::uint32_t const maxInFlight_;
+
+  AdmissionController* const parent_;
+
+  std::atomic<std::uint64_t> inFlight_{0u};
+
+  std::atomic<std::uint64_t> accepted_{0u};
+
+  std::atomic<std::uint64_t> shed_{0u};
+};
+
+} // namespace fservice
@@ -4,132 +4,527 @@
 
 #include <fservice/AsyncServer.h>
 
+#include <fservice/EnumUtil.h>
 #include <fservice/IServerEventHandler.h>
+#include <fservice/ThreadPlacement.h>
 
 #include <folly/io/async/EventBase.h>
 
+#include <grpcpp/alarm.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <string>
+#include <utility>
+
 namespace fservice {
 
-AsyncServer::AsyncServer(folly::EventBase& eventLoop,
-                         IServerEventHandler& serverEventHandler)
-    : eventLoop_(eventLoop), serverEventHandler_(serverEventHandler) {
+AsyncServer::AsyncServer(std::vector<folly::EventBase*> eventLoops,
+                         IServerEventHandler& serverEventHandler,
+                         ServerConfig const& config)
+    : eventLoops_(std::move(eventLoops)),
+      serverEventHandler_(serverEventHandler),
+      config_(config),
+      admissionController_(config.maxInFlight) {
+  for (auto* eventLoop : eventLoops_) {
+    dispatchQueues_.push_back(
+        std::make_shared<DispatchQueue>(eventLoop,
+                                        config_.laneWeights,
+                                        config_.laneCapacity,
+                                        config_.manualDispatch));
+  }
 }
 
 AsyncServer::~AsyncServer() {
   LOG_AUTO_TRACE();
-  stop();
+  shutdown(config_.drainTimeout);
 }
 
 void AsyncServer::runAsync(std::string const& address) {
   LOG_AUTO_TRACE();
   grpc::ServerBuilder builder;
+  applyTransportConfig(config_.transport, builder);
   builder.AddListeningPort(address, grpc::InsecureServerCredentials());
-  builder.RegisterService(&greeterAsyncService_);
-  completionQueue_ = builder.AddCompletionQueue();
+  if (config_.rawMode) {
+    // Calls of unregistered methods go to the generic service.
+    builder.RegisterAsyncGenericService(&genericService_);
+  } else {
+    builder.RegisterService(&greeterAsyncService_);
+  }
+  auto const queuesCount = std::max(1u, config_.queuesCount);
+  for (auto i = 0u; i < queuesCount; ++i) {
+    completionQueues_.emplace_back(builder.AddCompletionQueue());
+    queuePollers_.emplace_back(
+        std::make_unique<QueuePoller>(completionQueues_.back().get(),
+                                      config_.busyPollSpin,
+                                      config_.busyPollPark));
+  }
   grpcServer_ = builder.BuildAndStart();
-  LOG_INFOF("Server listening on {}", address);
+  LOG_INFOF("Server listening on {} with {} queue(s)", address, queuesCount);
+  liveCalls_.assign(completionQueues_.size(), 0u);
+  if (config_.cacheCapacity > 0u) {
+    // Shard per queue thread, event loops insert into the same shards.
+    responseCache_ = std::make_unique<ResponseCache>(
+        config_.cacheCapacity, config_.cacheTtl, completionQueues_.size());
+  }
+  if (config_.coalesceRequests) {
+    coalescer_ = std::make_unique<HelloCallDataPool::Coalescer>();
+  }
+  queuesIdle_.resize(completionQueues_.size());
+  assert(!eventLoops_.empty());
+  // Room for the armed backlog plus as many calls being processed, so the
+  // steady state never has to grow the pools.
+  auto const poolSize = 2u * std::max(1u, config_.prepostCount);
+  for (auto i = 0u; i < completionQueues_.size(); ++i) {
+    auto* dispatchQueue = dispatchQueues_[i % dispatchQueues_.size()].get();
+    auto* queueAdmissionController =
+        queueAdmissionControllers_
+            .emplace_back(std::make_unique<AdmissionController>(
+                config_.maxInFlightPerQueue, &admissionController_))
+            .get();
+    if (config_.rawMode) {
+      // Typed calls are not served in raw mode.
+      continue;
+    }
+    callDataPools_.emplace_back(std::make_unique<HelloCallDataPool>(
+        dispatchQueue,
+        &greeterAsyncService_,
+        completionQueues_[i].get(),
+        &serverEventHandler_,
+        &Greeter::AsyncService::RequestSayHello,
+        &IServerEventHandler::onSayHelloAsync,
+        queueAdmissionController,
+        responseCache_.get(),
+        coalescer_.get(),
+        &metrics_,
+        Rpc::SayHello,
+        poolSize));
+    batchCallDataPools_.emplace_back(std::make_unique<HelloBatchCallDataPool>(
+        dispatchQueue,
+        &greeterAsyncService_,
+        completionQueues_[i].get(),
+        &serverEventHandler_,
+        &Greeter::AsyncService::RequestSayHelloBatch,
+        &IServerEventHandler::onSayHelloBatchAsync,
+        queueAdmissionController,
+        nullptr,
+        nullptr,
+        &metrics_,
+        Rpc::SayHelloBatch,
+        poolSize));
+  }
   // Proceed to the server's main loop.
-  // Spawn reader thread that loops indefinitely
-  workerThread_ = std::thread(&AsyncServer::handleRpcs, this);
+  // Spawn one reader thread per queue. Each loops indefinitely.
+  for (auto i = 0u; i < completionQueues_.size(); ++i) {
+    workerThreads_.emplace_back(&AsyncServer::handleRpcs, this, i);
+  }
+}
+
+void AsyncServer::addStats(ServerStats& stats) const {
+  for (auto const& pool : callDataPools_) {
+    stats.callDataSlots += pool->getSlotsCount();
+    stats.callDataPoolExhausted += pool->getExhaustedCount();
+    stats.abortedCalls += pool->getAbortedCount();
+  }
+  for (auto const& pool : batchCallDataPools_) {
+    stats.callDataSlots += pool->getSlotsCount();
+    stats.callDataPoolExhausted += pool->getExhaustedCount();
+    stats.abortedCalls += pool->getAbortedCount();
+  }
+  for (auto const& queueAdmissionController : queueAdmissionControllers_) {
+    stats.acceptedCalls += queueAdmissionController->getAccepted();
+    stats.shedCalls += queueAdmissionController->getShed();
+  }
+  stats.abortedCalls += rawAbortedCalls_.load(std::memory_order_relaxed);
+  stats.inFlightCalls += admissionController_.getInFlight();
+  if (coalescer_ != nullptr) {
+    stats.coalescedCalls += coalescer_->getCoalesced();
+  }
+  if (responseCache_ != nullptr) {
+    stats.cacheHits += responseCache_->getHits();
+    stats.cacheMisses += responseCache_->getMisses();
+    stats.cacheEvictions += responseCache_->getEvictions();
+  }
+  for (auto const& queuePoller : queuePollers_) {
+    stats.queueCpuTimeUs += queuePoller->getCpuTimeUs();
+    stats.queueSpinHits += queuePoller->getSpinHits();
+    stats.queueParks += queuePoller->getParks();
+    stats.queueSpinTimeUs += queuePoller->getSpinTimeUs();
+  }
+  for (auto const& dispatchQueue : dispatchQueues_) {
+    for (auto i = 0u; i < kPrioritiesCount; ++i) {
+      stats.lanes[i] +=
+          dispatchQueue->getLaneStats(FromIntegral<Priority>(i));
+    }
+    auto const batchSizes = dispatchQueue->getBatchSizes();
+    for (auto i = 0u; i < batchSizes.size(); ++i) {
+      stats.dispatchBatches[i] += batchSizes[i];
+    }
+  }
+  metrics_.addSnapshot(stats.rpcs);
+  metrics_.addStagesSnapshot(stats.stages);
+}
+
+bool AsyncServer::processEvents(
+    std::size_t& budget, std::chrono::steady_clock::time_point deadline) {
+  // Start from the next queue each tick, so a busy queue which spends the
+  // budget does not starve the others.
+  auto pending = false;
+  for (auto i = 0u; i < dispatchQueues_.size(); ++i) {
+    auto& dispatchQueue =
+        *dispatchQueues_[(nextDispatchQueue_ + i) % dispatchQueues_.size()];
+    pending = dispatchQueue.drain(budget, deadline) || pending;
+  }
+  nextDispatchQueue_ = (nextDispatchQueue_ + 1u) % dispatchQueues_.size();
+  return pending;
 }
 
-void AsyncServer::stop() {
+void AsyncServer::shutdown(std::chrono::milliseconds const drainTimeout) {
   LOG_AUTO_TRACE();
-  assert(workerThread_.joinable());
+  assert(!workerThreads_.empty());
+  if (stopped_) {
+    return;
+  }
+  stopped_ = true;
 
-  grpcServer_->Shutdown();
-  // Always shutdown the completion queue after the server.
-  completionQueue_->Shutdown();
+  LOG_INFOF("Draining server for up to {} ms. Calls in flight: {}",
+            drainTimeout.count(),
+            admissionController_.getInFlight());
+  // Stops accepting calls, waits for the calls in flight up to the deadline
+  // and cancels the rest.
+  grpcServer_->Shutdown(std::chrono::system_clock::now() + drainTimeout);
+  LOG_INFOF("Server shut down. Calls cancelled in flight: {}",
+            admissionController_.getInFlight());
 
-  workerThread_.join();
+  // Handlers of cancelled calls may still be queued in the event loops and
+  // will call Finish. Queues must stay open until all their calls are gone.
+  draining_ = true;
+  // Wake up the queue threads in case their queues are idle already.
+  std::vector<grpc::Alarm> alarms(completionQueues_.size());
+  for (auto i = 0u; i < completionQueues_.size(); ++i) {
+    alarms[i].Set(completionQueues_[i].get(),
+                  std::chrono::system_clock::now(),
+                  wakeupTag_.tag());
+  }
+  for (auto& queueIdle : queuesIdle_) {
+    queueIdle.get_future().wait();
+  }
+
+  // Always shutdown the completion queues after the server.
+  for (auto& completionQueue : completionQueues_) {
+    completionQueue->Shutdown();
+  }
+
+  for (auto& workerThread : workerThreads_) {
+    workerThread.join();
+  }
+  LOG_INFO("Server drained");
 }
 
-AsyncServer::CallData::CallData(folly::EventBase* eventLoop,
-                                Greeter::AsyncService* service,
-                                grpc::ServerCompletionQueue* completionQueue,
-                                IServerEventHandler* serverEventHandler)
-    : eventLoop_(eventLoop),
+AsyncServer::StreamCallData::StreamCallData(
+    DispatchQueue* dispatchQueue,
+    Greeter::AsyncService* service,
+    grpc::ServerCompletionQueue* completionQueue,
+    IServerEventHandler* serverEventHandler,
+    std::size_t maxPendingReplies,
+    Metrics* metrics,
+    std::size_t& liveCalls)
+    : HelloStreamSession(serverEventHandler, maxPendingReplies),
+      dispatchQueue_(dispatchQueue),
       service_(service),
       completionQueue_(completionQueue),
       serverEventHandler_(serverEventHandler),
-      responder_(&context_),
-      status_(CallStatus::CREATE) {
-  proceed(true);
-}
-
-void AsyncServer::CallData::proceed(bool const ok) {
-  if (ok && status_ == CallStatus::CREATE) {
-    // Make this instance progress to the PROCESS state.
-    status_ = CallStatus::PROCESS;
-
-    // As part of the initial CREATE state, we *request* that the system
-    // start processing SayHello requests. In this request, "this" acts are
-    // the tag uniquely identifying the request (so that different CallData
-    // instances can serve different requests concurrently), in this case
-    // the memory address of this CallData instance.
-    service_->RequestSayHello(&context_,
-                              &request_,
-                              &responder_,
-                              completionQueue_,
-                              completionQueue_,
-                              this);
-  } else if (ok && status_ == CallStatus::PROCESS) {
-    LOG_TRACE("Processing request");
-    // Spawn a new CallData instance to serve new clients while we process
-    // the one for this CallData. The instance will deallocate itself as
-    // part of its FINISH state.
-    new CallData(eventLoop_, service_, completionQueue_, serverEventHandler_);
-
-    // Handle request in the event loop
-    eventLoop_->runInEventBaseThread([this]() {
-      serverEventHandler_->onSayHello(request_, reply_);
-
-      // And we are done! Let the gRPC runtime know we've
-      // finished, using
-      // the memory address of this instance as the uniquely identifying tag
-      // for the event.
-      status_ = CallStatus::FINISH;
-      responder_.Finish(reply_, grpc::Status::OK, this);
-    });
-
-    // eventLoop_->runInEventBaseThread([this]() {
-    //  serverEventHandler_->onSayHello(request_, reply_);
-
-    /*
-    reply_.set_message("Hello " + request_.name());
-
-    // And we are done! Let the gRPC runtime know we've finished, using
-    // the memory address of this instance as the uniquely identifying tag
-    // for the event.
-    status_ = CallStatus::FINISH;
-    responder_.Finish(reply_, grpc::Status::OK, this);
-    */
-  } else {
-    // Not ok or CallStatus::FINISH
-    // Once in the FINISH state, deallocate ourselves (CallData).
+      maxPendingReplies_(maxPendingReplies),
+      metrics_(metrics),
+      liveCalls_(liveCalls),
+      stream_(&context_),
+      connectTag_(this),
+      readTag_(this),
+      writeTag_(this),
+      finishTag_(this) {
+  ++liveCalls_;
+}
+
+AsyncServer::StreamCallData::~StreamCallData() {
+  --liveCalls_;
+}
+
+void AsyncServer::StreamCallData::arm() {
+  service_->RequestSayHelloStream(&context_,
+                                  &stream_,
+                                  completionQueue_,
+                                  completionQueue_,
+                                  connectTag_.tag());
+}
+
+void AsyncServer::StreamCallData::onConnected(bool ok) {
+  if (!ok) {
+    // Server is shutting down.
     delete this;
+    return;
   }
+  LOG_TRACE("Stream connected");
+  acceptedAt_ = std::chrono::steady_clock::now();
+  metrics_->onAccepted(Rpc::SayHelloStream);
+  // Serve next stream while this one is active.
+  (new StreamCallData(dispatchQueue_,
+                      service_,
+                      completionQueue_,
+                      serverEventHandler_,
+                      maxPendingReplies_,
+                      metrics_,
+                      liveCalls_))
+      ->arm();
+  start();
+}
+
+void AsyncServer::StreamCallData::onRead(bool ok) {
+  onReadDone(ok);
+}
+
+void AsyncServer::StreamCallData::onWritten(bool ok) {
+  onWriteDone(ok);
+}
+
+void AsyncServer::StreamCallData::onFinished(bool ok) {
+  LOG_TRACE("Stream finished");
+  metrics_->onFinished(Rpc::SayHelloStream,
+                       ok && finishedOk_,
+                       std::chrono::steady_clock::now() - acceptedAt_);
+  synchronize();
+  delete this;
+}
+
+void AsyncServer::StreamCallData::startRead() {
+  stream_.Read(&request_, readTag_.tag());
 }
 
-void AsyncServer::handleRpcs() {
-  // Spawn a new CallData instance to serve new clients.
-  new CallData(&eventLoop_,
-               &greeterAsyncService_,
-               completionQueue_.get(),
-               &serverEventHandler_);
+void AsyncServer::StreamCallData::startWrite(HelloReply const& reply) {
+  stream_.Write(reply, writeTag_.tag());
+}
+
+void AsyncServer::StreamCallData::finish(grpc::Status const& status) {
+  finishedOk_ = status.ok();
+  stream_.Finish(status, finishTag_.tag());
+}
+
+void AsyncServer::StreamCallData::runInEventLoop(
+    folly::Function<void()> task) {
+  dispatchQueue_->runInLoop(getCallPriority(context_), std::move(task));
+}
+
+AsyncServer::RawCallData::RawCallData(
+    DispatchQueue* dispatchQueue,
+    grpc::AsyncGenericService* service,
+    grpc::ServerCompletionQueue* completionQueue,
+    IServerEventHandler* serverEventHandler,
+    AdmissionController* admissionController,
+    Metrics* metrics,
+    std::atomic<std::uint64_t>* abortedCount,
+    std::size_t& liveCalls)
+    : dispatchQueue_(dispatchQueue),
+      service_(service),
+      completionQueue_(completionQueue),
+      serverEventHandler_(serverEventHandler),
+      admissionController_(admissionController),
+      metrics_(metrics),
+      abortedCount_(abortedCount),
+      liveCalls_(liveCalls),
+      stream_(&context_),
+      connectTag_(this),
+      readTag_(this),
+      finishTag_(this),
+      doneTag_(this) {
+  ++liveCalls_;
+}
+
+AsyncServer::RawCallData::~RawCallData() {
+  if (admitted_) {
+    admissionController_->release();
+  }
+  --liveCalls_;
+}
+
+void AsyncServer::RawCallData::arm() {
+  // Must be set before the call starts. The tag is returned only if the call
+  // starts.
+  context_.AsyncNotifyWhenDone(doneTag_.tag());
+  service_->RequestCall(&context_,
+                        &stream_,
+                        completionQueue_,
+                        completionQueue_,
+                        connectTag_.tag());
+}
+
+void AsyncServer::RawCallData::onConnected(bool ok) {
+  if (!ok) {
+    // Server is shutting down.
+    delete this;
+    return;
+  }
+  acceptedAt_ = std::chrono::steady_clock::now();
+  metrics_->onAccepted(Rpc::Raw);
+  // Call has started: wait for the Finish and the done tags.
+  pendingTags_ = 2u;
+  // Serve next call while this one is active.
+  (new RawCallData(dispatchQueue_,
+                   service_,
+                   completionQueue_,
+                   serverEventHandler_,
+                   admissionController_,
+                   metrics_,
+                   abortedCount_,
+                   liveCalls_))
+      ->arm();
+  stream_.Read(&request_, readTag_.tag());
+}
+
+void AsyncServer::RawCallData::onRead(bool ok) {
+  if (!ok) {
+    finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                        "Unary request expected"));
+    return;
+  }
+  // Don't queue work nobody waits for.
+  if (auto const abortStatus = getAbortStatus(); !abortStatus.ok()) {
+    abort(abortStatus);
+    return;
+  }
+  // Fail fast instead of growing the event loop queue when overloaded.
+  if (!admissionController_->tryAcquire()) {
+    LOG_DEBUG("Too many calls in flight. Shedding request.");
+    finish(grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                        "Too many calls in flight"));
+    return;
+  }
+  admitted_ = true;
+
+  dispatchQueue_->post(getCallPriority(context_), [this]() {
+    // Call may have died while waiting in the event loop queue.
+    if (auto const abortStatus = getAbortStatus(); !abortStatus.ok()) {
+      abort(abortStatus);
+      return;
+    }
+    finish(serverEventHandler_->onRawCall(context_.method(), request_, reply_));
+  });
+}
+
+void AsyncServer::RawCallData::onFinished(bool ok) {
+  metrics_->onFinished(Rpc::Raw,
+                       ok && finishedOk_,
+                       std::chrono::steady_clock::now() - acceptedAt_);
+  onTagDone();
+}
+
+void AsyncServer::RawCallData::onDone(bool) {
+  // IsCancelled is safe to call only after the done tag is delivered.
+  if (context_.IsCancelled()) {
+    LOG_TRACE("Call cancelled");
+    cancelled_.store(true, std::memory_order_relaxed);
+  }
+  onTagDone();
+}
+
+void AsyncServer::RawCallData::onTagDone() {
+  assert(pendingTags_ > 0u);
+  if (--pendingTags_ == 0u) {
+    delete this;
+  }
+}
+
+grpc::Status AsyncServer::RawCallData::getAbortStatus() const {
+  if (cancelled_.load(std::memory_order_relaxed)) {
+    return grpc::Status::CANCELLED;
+  }
+  // Deadline is infinite if the client has not set it.
+  if (context_.deadline() <= std::chrono::system_clock::now()) {
+    return grpc::Status(grpc::StatusCode::DEADLINE_EXCEEDED,
+                        "Deadline exceeded");
+  }
+  return grpc::Status::OK;
+}
+
+void AsyncServer::RawCallData::abort(grpc::Status const& status) {
+  LOG_DEBUGF("Call dropped without handling: {}", status.error_message());
+  abortedCount_->fetch_add(1u, std::memory_order_relaxed);
+  finish(status);
+}
+
+void AsyncServer::RawCallData::finish(grpc::Status const& status) {
+  finishedOk_ = status.ok();
+  if (status.ok()) {
+    stream_.WriteAndFinish(
+        reply_, grpc::WriteOptions(), status, finishTag_.tag());
+  } else {
+    stream_.Finish(status, finishTag_.tag());
+  }
+}
+
+void AsyncServer::handleRpcs(std::size_t queueIndex) {
+  placeCurrentThread("CQThread" + std::to_string(queueIndex),
+                     config_.placement.queueCores,
+                     queueIndex,
+                     config_.placement.localMemory);
+  auto* dispatchQueue =
+      dispatchQueues_[queueIndex % dispatchQueues_.size()].get();
+  if (config_.rawMode) {
+    for (auto i = 0u; i < std::max(1u, config_.prepostCount); ++i) {
+      (new RawCallData(dispatchQueue,
+                       &genericService_,
+                       completionQueues_[queueIndex].get(),
+                       &serverEventHandler_,
+                       queueAdmissionControllers_[queueIndex].get(),
+                       &metrics_,
+                       &rawAbortedCalls_,
+                       liveCalls_[queueIndex]))
+          ->arm();
+    }
+  } else {
+    // Arm pooled CallData instances to serve new clients. Each served call
+    // arms a replacement, so the backlog depth stays constant.
+    for (auto i = 0u; i < std::max(1u, config_.prepostCount); ++i) {
+      callDataPools_[queueIndex]->acquire()->arm();
+      batchCallDataPools_[queueIndex]->acquire()->arm();
+    }
+    // Streams are long living, one armed call per queue is enough.
+    (new StreamCallData(dispatchQueue,
+                        &greeterAsyncService_,
+                        completionQueues_[queueIndex].get(),
+                        &serverEventHandler_,
+                        config_.streamMaxPendingReplies,
+                        &metrics_,
+                        liveCalls_[queueIndex]))
+        ->arm();
+  }
   void* tag; // uniquely identifies a request.
   bool ok;
 
-  // Block waiting to read the next event from the completion queue. The
-  // event is uniquely identified by its tag, which in this case is the
-  // memory address of a CallData instance.
-  // The return value of Next should always be checked. This return value
-  // tells us whether there is any kind of event or completionQueue_ is
-  // shutting down.
-  while (completionQueue_->Next(&tag, &ok)) {
-    auto* callData = static_cast<CallData*>(tag);
-    callData->proceed(ok);
+  // Wait for the next event from the completion queue. The event is uniquely
+  // identified by its tag, which in this case is the memory address of a
+  // CallData instance or of an operation tag of a stream. The return value
+  // of next should always be checked. This return value tells us whether
+  // there is any kind of event or completionQueue is shutting down.
+  auto& queuePoller = *queuePollers_[queueIndex];
+  queuePoller.bindCurrentThread();
+  auto idleReported = false;
+  while (queuePoller.next(&tag, &ok)) {
+    static_cast<ICompletionTag*>(tag)->proceed(ok);
+    if (!idleReported && draining_ && isQueueIdle(queueIndex)) {
+      idleReported = true;
+      queuesIdle_[queueIndex].set_value();
+    }
+  }
+  queuePoller.unbindCurrentThread();
+}
+
+bool AsyncServer::isQueueIdle(std::size_t queueIndex) const {
+  if (liveCalls_[queueIndex] != 0u) {
+    return false;
   }
+  // Raw mode has no pools.
+  return config_.rawMode || (callDataPools_[queueIndex]->isIdle() &&
+                             batchCallDataPools_[queueIndex]->isIdle());
 }
 
-} // namespace fservice
\ No newline at end of file
+} // namespace fservice
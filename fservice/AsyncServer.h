@@ -4,13 +4,32 @@
 
 #pragma once
 
+#include <fservice/AdmissionController.h>
+#include <fservice/CompletionTag.h>
+#include <fservice/DispatchQueue.h>
+#include <fservice/HelloStreamSession.h>
+#include <fservice/IServer.h>
 #include <fservice/Logger.h>
+#include <fservice/Metrics.h>
+#include <fservice/QueuePoller.h>
+#include <fservice/RequestCoalescer.h>
+#include <fservice/ResponseCache.h>
+#include <fservice/ServerConfig.h>
+#include <fservice/UnaryCallData.h>
 
 #include <protos/Greeter.grpc.pb.h>
 
+#include <grpcpp/generic/async_generic_service.h>
 #include <grpcpp/grpcpp.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
 #include <thread>
+#include <vector>
 
 namespace folly {
 
@@ -23,79 +42,284 @@ namespace fservice {
 struct IServerEventHandler;
 
 /* Grps Async server */
-class AsyncServer final {
+class AsyncServer final : public IServer {
  public:
-  AsyncServer(folly::EventBase& eventLoop,
-              IServerEventHandler& serverEventHandler);
+  /* Requests taken from completion queue i are handled in event loop
+   * eventLoops[i % eventLoops.size()]. */
+  AsyncServer(std::vector<folly::EventBase*> eventLoops,
+              IServerEventHandler& serverEventHandler,
+              ServerConfig const& config = {});
 
-  ~AsyncServer();
+  ~AsyncServer() override;
 
-  void runAsync(std::string const& address);
+  void runAsync(std::string const& address) override;
+
+  void addStats(ServerStats& stats) const override;
+
+  bool processEvents(std::size_t& budget,
+                     std::chrono::steady_clock::time_point deadline) override;
+
+  void shutdown(std::chrono::milliseconds drainTimeout) override;
 
  private:
-  /* Sync call to stop server. */
-  void stop();
+  using HelloCallDataPool = UnaryCallDataPool<HelloRequest, HelloReply>;
 
-  /* Holds context of client request. */
-  class CallData {
+  using HelloBatchCallDataPool =
+      UnaryCallDataPool<HelloBatchRequest, HelloBatchReply>;
+
+  /* Holds context of SayHelloStream call. Allocated per stream and deletes
+   * itself once the stream is finished. */
+  class StreamCallData final : public HelloStreamSession {
    public:
-    CallData(folly::EventBase* eventLoop,
-             Greeter::AsyncService* service,
-             grpc::ServerCompletionQueue* completionQueue,
-             IServerEventHandler* serverEventHandler);
+    StreamCallData(DispatchQueue* dispatchQueue,
+                   Greeter::AsyncService* service,
+                   grpc::ServerCompletionQueue* completionQueue,
+                   IServerEventHandler* serverEventHandler,
+                   std::size_t maxPendingReplies,
+                   Metrics* metrics,
+                   std::size_t& liveCalls);
+
+    ~StreamCallData() override;
 
-    void proceed(bool const ok);
+    /* Request the system to deliver the next SayHelloStream call. */
+    void arm();
 
    private:
-    DECLARE_GET_LOGGER("Server.CallData")
+    void onConnected(bool ok);
+
+    void onRead(bool ok);
+
+    void onWritten(bool ok);
+
+    void onFinished(bool ok);
+
+    void startRead() override;
+
+    void startWrite(HelloReply const& reply) override;
 
-    folly::EventBase* eventLoop_;
+    void finish(grpc::Status const& status) override;
+
+    /* Goes through the lanes in manual mode, so the handlers of the stream
+     * count against the budget of the tick. */
+    void runInEventLoop(folly::Function<void()> task) override;
+
+    DispatchQueue* dispatchQueue_;
 
     Greeter::AsyncService* service_;
 
-    /* The producer-consumer queue where for asynchronous server
-     * notifications.*/
     grpc::ServerCompletionQueue* completionQueue_;
 
     IServerEventHandler* serverEventHandler_;
 
-    /* Context for the rpc, allowing to tweak aspects of it such as the use of
-     * compression, authentication, as well as to send metadata back to the
-     * client. */
+    std::size_t const maxPendingReplies_;
+
+    Metrics* metrics_;
+
+    /* Number of calls of the queue. Touched only by the queue thread. */
+    std::size_t& liveCalls_;
+
+    /* When the stream was connected. */
+    std::chrono::steady_clock::time_point acceptedAt_;
+
+    /* Stream is finished with OK status. */
+    bool finishedOk_ = false;
+
     grpc::ServerContext context_;
 
-    /* Request from the client. */
-    HelloRequest request_;
+    grpc::ServerAsyncReaderWriter<HelloReply, HelloRequest> stream_;
 
-    /* Response to the client. */
-    HelloReply reply_;
+    /* One tag per kind of operation. Read and write may be in flight at the
+     * same time. */
+    MemberCompletionTag<StreamCallData, &StreamCallData::onConnected>
+        connectTag_;
 
-    /* The means to get back to the client. */
-    grpc::ServerAsyncResponseWriter<HelloReply> responder_;
+    MemberCompletionTag<StreamCallData, &StreamCallData::onRead> readTag_;
 
-    /* Request states */
-    enum class CallStatus { CREATE, PROCESS, FINISH };
+    MemberCompletionTag<StreamCallData, &StreamCallData::onWritten> writeTag_;
 
-    /*The current serving state. */
-    CallStatus status_;
+    MemberCompletionTag<StreamCallData, &StreamCallData::onFinished>
+        finishTag_;
   };
 
   DECLARE_GET_LOGGER("Server")
 
-  /* Check pending Rpcs. This can be run in multiple threads if needed. */
-  void handleRpcs();
+  /* Holds context of a unary call served in raw mode. Request and reply stay
+   * in wire format. Allocated per call and deletes itself once finished. */
+  class RawCallData final {
+   public:
+    RawCallData(DispatchQueue* dispatchQueue,
+                grpc::AsyncGenericService* service,
+                grpc::ServerCompletionQueue* completionQueue,
+                IServerEventHandler* serverEventHandler,
+                AdmissionController* admissionController,
+                Metrics* metrics,
+                std::atomic<std::uint64_t>* abortedCount,
+                std::size_t& liveCalls);
+
+    ~RawCallData();
+
+    RawCallData(RawCallData const&) = delete;
+    RawCallData& operator=(RawCallData const&) = delete;
+
+    /* Request the system to deliver the next call of any method. */
+    void arm();
+
+   private:
+    DECLARE_GET_LOGGER("Server.RawCallData")
+
+    void onConnected(bool ok);
+
+    void onRead(bool ok);
+
+    void onFinished(bool ok);
+
+    /* Completion of AsyncNotifyWhenDone. Call is finished or cancelled. */
+    void onDone(bool ok);
+
+    /* Delete the call once both Finish and done tags are back. */
+    void onTagDone();
+
+    /* Status to finish the call with instead of handling it: client has
+     * cancelled the call or its deadline has passed. OK if the call is
+     * alive. */
+    grpc::Status getAbortStatus() const;
+
+    /* Finish without handling. */
+    void abort(grpc::Status const& status);
+
+    /* Finish the call, writing reply if status is OK. */
+    void finish(grpc::Status const& status);
+
+    DispatchQueue* dispatchQueue_;
+
+    grpc::AsyncGenericService* service_;
+
+    grpc::ServerCompletionQueue* completionQueue_;
+
+    IServerEventHandler* serverEventHandler_;
+
+    AdmissionController* admissionController_;
+
+    Metrics* metrics_;
 
-  folly::EventBase& eventLoop_;
+    /* Raw calls finished without handling, of all queues. */
+    std::atomic<std::uint64_t>* abortedCount_;
+
+    /* Number of calls of the queue. Touched only by the queue thread. */
+    std::size_t& liveCalls_;
+
+    /* Call holds a slot of the admission controller. */
+    bool admitted_ = false;
+
+    /* When the call was connected. */
+    std::chrono::steady_clock::time_point acceptedAt_;
+
+    /* Call is finished with OK status. */
+    bool finishedOk_ = false;
+
+    /* Tags given to gRPC and not returned yet. Touched only by the queue
+     * thread. */
+    std::uint32_t pendingTags_ = 0u;
+
+    /* Set by the queue thread when the done tag reports cancellation. Read by
+     * the event loop before running the handler. */
+    std::atomic<bool> cancelled_{false};
+
+    grpc::GenericServerContext context_;
+
+    grpc::GenericServerAsyncReaderWriter stream_;
+
+    grpc::ByteBuffer request_;
+
+    grpc::ByteBuffer reply_;
+
+    MemberCompletionTag<RawCallData, &RawCallData::onConnected> connectTag_;
+
+    MemberCompletionTag<RawCallData, &RawCallData::onRead> readTag_;
+
+    MemberCompletionTag<RawCallData, &RawCallData::onFinished> finishTag_;
+
+    MemberCompletionTag<RawCallData, &RawCallData::onDone> doneTag_;
+  };
+
+  /* Tag which only wakes up the queue thread. */
+  struct WakeupTag final : public ICompletionTag {
+    void proceed(bool) override {
+    }
+  };
+
+  /* Check pending Rpcs of the queue with given index. Runs in the queue's own
+   * thread. */
+  void handleRpcs(std::size_t queueIndex);
+
+  /* No call of the queue is left, so the queue may be shut down. Runs in the
+   * queue's own thread. */
+  bool isQueueIdle(std::size_t queueIndex) const;
+
+  /* Shards which handle requests. Queues are affined to shards. */
+  std::vector<folly::EventBase*> const eventLoops_;
+
+  /* Priority lanes of each event loop, indexed as eventLoops_. */
+  std::vector<std::shared_ptr<DispatchQueue>> dispatchQueues_;
+
+  /* Queue processEvents starts the next tick from. */
+  std::size_t nextDispatchQueue_ = 0u;
 
   IServerEventHandler& serverEventHandler_;
 
-  std::unique_ptr<grpc::ServerCompletionQueue> completionQueue_;
+  ServerConfig const config_;
+
+  /* One queue per worker thread. Each queue has its own pre-posted calls so
+   * threads never contend for the same tags. */
+  std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> completionQueues_;
+
+  /* Takes events of each queue, blocking or busy polling. */
+  std::vector<std::unique_ptr<QueuePoller>> queuePollers_;
+
+  /* Bounds unary calls of all queues. */
+  AdmissionController admissionController_;
+
+  /* Bounds unary calls of each queue. Chained to admissionController_. */
+  std::vector<std::unique_ptr<AdmissionController>> queueAdmissionControllers_;
+
+  /* Replies of SayHello shared by all queues. Null if disabled. */
+  std::unique_ptr<ResponseCache> responseCache_;
+
+  /* Identical SayHello calls in flight of all queues. Null if disabled. */
+  std::unique_ptr<HelloCallDataPool::Coalescer> coalescer_;
+
+  /* Calls of all queues by method. */
+  Metrics metrics_;
+
+  /* Streams and raw calls of each queue. */
+  std::vector<std::size_t> liveCalls_;
+
+  /* Raw calls of all queues finished without handling. */
+  std::atomic<std::uint64_t> rawAbortedCalls_{0u};
+
+  /* Set once the server is shut down. Queue threads then report when their
+   * queues become idle. */
+  std::atomic_bool draining_{false};
+
+  std::vector<std::promise<void>> queuesIdle_;
+
+  WakeupTag wakeupTag_;
+
+  bool stopped_ = false;
+
+  /* CallData slabs for each queue. Empty in raw mode. */
+  std::vector<std::unique_ptr<HelloCallDataPool>> callDataPools_;
+
+  std::vector<std::unique_ptr<HelloBatchCallDataPool>> batchCallDataPools_;
 
   Greeter::AsyncService greeterAsyncService_;
 
+  /* Serves all methods in raw mode instead of greeterAsyncService_. */
+  grpc::AsyncGenericService genericService_;
+
   std::unique_ptr<grpc::Server> grpcServer_;
 
-  std::thread workerThread_;
+  std::vector<std::thread> workerThreads_;
 };
 
 } // namespace fservice
\ No newline at end of file
@@ -0,0 +1,266 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/CallbackServer.h>
+
+#include <fservice/IServerEventHandler.h>
+
+#include <folly/io/async/EventBase.h>
+
+#include <cassert>
+#include <chrono>
+#include <utility>
+
+namespace fservice {
+
+CallbackServer::CallbackServer(std::vector<folly::EventBase*> eventLoops,
+                               IServerEventHandler& serverEventHandler,
+                               ServerConfig const& config)
+    : eventLoops_(std::move(eventLoops)),
+      serverEventHandler_(serverEventHandler),
+      config_(config),
+      admissionController_(config.maxInFlight),
+      greeterService_(*this) {
+  assert(!eventLoops_.empty());
+}
+
+CallbackServer::~CallbackServer() {
+  LOG_AUTO_TRACE();
+  shutdown(config_.drainTimeout);
+}
+
+void CallbackServer::runAsync(std::string const& address) {
+  LOG_AUTO_TRACE();
+  if (config_.rawMode) {
+    LOG_WARN("Raw mode is not supported by callback server. Ignored.");
+  }
+  grpc::ServerBuilder builder;
+  applyTransportConfig(config_.transport, builder);
+  builder.AddListeningPort(address, grpc::InsecureServerCredentials());
+  builder.RegisterService(&greeterService_);
+  grpcServer_ = builder.BuildAndStart();
+  LOG_INFOF("Callback server listening on {}", address);
+}
+
+void CallbackServer::addStats(ServerStats& stats) const {
+  // No CallData pools in this backend, only admission counters.
+  stats.acceptedCalls += admissionController_.getAccepted();
+  stats.shedCalls += admissionController_.getShed();
+  stats.inFlightCalls += admissionController_.getInFlight();
+  stats.abortedCalls += abortedCount_.load(std::memory_order_relaxed);
+  metrics_.addSnapshot(stats.rpcs);
+}
+
+bool CallbackServer::processEvents(
+    std::size_t& /*budget*/,
+    std::chrono::steady_clock::time_point /*deadline*/) {
+  return false;
+}
+
+void CallbackServer::shutdown(std::chrono::milliseconds const drainTimeout) {
+  LOG_AUTO_TRACE();
+  assert(grpcServer_ != nullptr);
+  if (stopped_) {
+    return;
+  }
+  stopped_ = true;
+
+  LOG_INFOF("Draining server for up to {} ms. Calls in flight: {}",
+            drainTimeout.count(),
+            admissionController_.getInFlight());
+  // Cancels calls in flight at the deadline, then waits for the reactors
+  // which are still handled in the event loops.
+  grpcServer_->Shutdown(std::chrono::system_clock::now() + drainTimeout);
+  LOG_INFO("Server drained");
+}
+
+folly::EventBase* CallbackServer::nextEventLoop() {
+  auto const index =
+      nextEventLoopIndex_.fetch_add(1u, std::memory_order_relaxed);
+  return eventLoops_[index % eventLoops_.size()];
+}
+
+grpc::Status CallbackServer::getAbortStatus(
+    grpc::CallbackServerContext* context) {
+  if (context->IsCancelled()) {
+    return grpc::Status::CANCELLED;
+  }
+  // Deadline is infinite if the client has not set it.
+  if (context->deadline() <= std::chrono::system_clock::now()) {
+    return grpc::Status(grpc::StatusCode::DEADLINE_EXCEEDED,
+                        "Deadline exceeded");
+  }
+  return grpc::Status::OK;
+}
+
+void CallbackServer::finishCall(
+    grpc::ServerUnaryReactor* reactor,
+    Rpc const rpc,
+    std::chrono::steady_clock::time_point const acceptedAt,
+    grpc::Status const& status) {
+  metrics_.onFinished(
+      rpc, status.ok(), std::chrono::steady_clock::now() - acceptedAt);
+  reactor->Finish(status);
+}
+
+CallbackServer::GreeterService::GreeterService(CallbackServer& server)
+    : server_(server) {
+}
+
+template <typename Request, typename Reply>
+grpc::ServerUnaryReactor* CallbackServer::GreeterService::dispatch(
+    grpc::CallbackServerContext* context,
+    Request const* request,
+    Reply* reply,
+    folly::SemiFuture<folly::Unit> (IServerEventHandler::*handleMethod)(
+        Request const&, Reply&),
+    Rpc const rpc) {
+  LOG_TRACE("Processing request");
+  auto const acceptedAt = std::chrono::steady_clock::now();
+  server_.metrics_.onAccepted(rpc);
+  // Request and reply are owned by gRPC until the reactor is finished.
+  auto* reactor = context->DefaultReactor();
+  // Fail fast instead of growing the event loop queue when overloaded.
+  if (!server_.admissionController_.tryAcquire()) {
+    LOG_DEBUG("Too many calls in flight. Shedding request.");
+    server_.finishCall(reactor,
+                       rpc,
+                       acceptedAt,
+                       grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                                    "Too many calls in flight"));
+    return reactor;
+  }
+  auto* eventLoop = server_.nextEventLoop();
+  eventLoop->runInEventBaseThread([this,
+                                   context,
+                                   request,
+                                   reply,
+                                   reactor,
+                                   handleMethod,
+                                   eventLoop,
+                                   rpc,
+                                   acceptedAt]() {
+    // Call may have died while waiting in the event loop queue.
+    if (auto const abortStatus = getAbortStatus(context); !abortStatus.ok()) {
+      server_.abortedCount_.fetch_add(1u, std::memory_order_relaxed);
+      server_.admissionController_.release();
+      server_.finishCall(reactor, rpc, acceptedAt, abortStatus);
+      return;
+    }
+    auto handled =
+        (server_.serverEventHandler_.*handleMethod)(*request, *reply);
+    auto finish = [this, context, reactor, rpc, acceptedAt](
+                      folly::Try<folly::Unit> const& result) {
+      server_.admissionController_.release();
+      if (result.hasException()) {
+        LOG_ERRORF("Handler failed: {}",
+                   result.exception().what().toStdString());
+        server_.finishCall(
+            reactor,
+            rpc,
+            acceptedAt,
+            grpc::Status(grpc::StatusCode::INTERNAL, "Handler failed"));
+        return;
+      }
+      // Skip sending the reply if the call has died meanwhile, as the cq
+      // backend does.
+      if (auto const abortStatus = getAbortStatus(context);
+          !abortStatus.ok()) {
+        server_.abortedCount_.fetch_add(1u, std::memory_order_relaxed);
+        server_.finishCall(reactor, rpc, acceptedAt, abortStatus);
+        return;
+      }
+      server_.finishCall(reactor, rpc, acceptedAt, grpc::Status::OK);
+    };
+    if (handled.isReady()) {
+      finish(std::move(handled).getTry());
+      return;
+    }
+    // Request and reply stay alive until the reactor is finished.
+    std::move(handled)
+        .via(folly::getKeepAliveToken(eventLoop))
+        .thenTry(std::move(finish));
+  });
+  return reactor;
+}
+
+grpc::ServerUnaryReactor* CallbackServer::GreeterService::SayHello(
+    grpc::CallbackServerContext* context,
+    HelloRequest const* request,
+    HelloReply* reply) {
+  return dispatch(context,
+                  request,
+                  reply,
+                  &IServerEventHandler::onSayHelloAsync,
+                  Rpc::SayHello);
+}
+
+grpc::ServerUnaryReactor* CallbackServer::GreeterService::SayHelloBatch(
+    grpc::CallbackServerContext* context,
+    HelloBatchRequest const* request,
+    HelloBatchReply* reply) {
+  return dispatch(context,
+                  request,
+                  reply,
+                  &IServerEventHandler::onSayHelloBatchAsync,
+                  Rpc::SayHelloBatch);
+}
+
+grpc::ServerBidiReactor<HelloRequest, HelloReply>*
+CallbackServer::GreeterService::SayHelloStream(grpc::CallbackServerContext*) {
+  LOG_TRACE("Stream connected");
+  return new StreamReactor(server_.nextEventLoop(),
+                           &server_.serverEventHandler_,
+                           server_.config_.streamMaxPendingReplies,
+                           &server_.metrics_);
+}
+
+CallbackServer::StreamReactor::StreamReactor(
+    folly::EventBase* eventLoop,
+    IServerEventHandler* serverEventHandler,
+    std::size_t maxPendingReplies,
+    Metrics* metrics)
+    : HelloStreamSession(serverEventHandler, maxPendingReplies),
+      eventLoop_(eventLoop),
+      metrics_(metrics),
+      acceptedAt_(std::chrono::steady_clock::now()) {
+  metrics_->onAccepted(Rpc::SayHelloStream);
+  start();
+}
+
+void CallbackServer::StreamReactor::OnReadDone(bool ok) {
+  onReadDone(ok);
+}
+
+void CallbackServer::StreamReactor::OnWriteDone(bool ok) {
+  onWriteDone(ok);
+}
+
+void CallbackServer::StreamReactor::OnDone() {
+  metrics_->onFinished(Rpc::SayHelloStream,
+                       finishedOk_,
+                       std::chrono::steady_clock::now() - acceptedAt_);
+  synchronize();
+  delete this;
+}
+
+void CallbackServer::StreamReactor::startRead() {
+  StartRead(&request_);
+}
+
+void CallbackServer::StreamReactor::startWrite(HelloReply const& reply) {
+  StartWrite(&reply);
+}
+
+void CallbackServer::StreamReactor::finish(grpc::Status const& status) {
+  finishedOk_ = status.ok();
+  Finish(status);
+}
+
+void CallbackServer::StreamReactor::runInEventLoop(
+    folly::Function<void()> task) {
+  eventLoop_->runInEventBaseThread(std::move(task));
+}
+
+} // namespace fservice
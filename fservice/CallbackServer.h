@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <fservice/AdmissionController.h>
+#include <fservice/HelloStreamSession.h>
+#include <fservice/IServer.h>
+#include <fservice/Logger.h>
+#include <fservice/Metrics.h>
+#include <fservice/ServerConfig.h>
+
+#include <protos/Greeter.grpc.pb.h>
+
+#include <folly/Function.h>
+#include <folly/Unit.h>
+#include <folly/futures/Future.h>
+
+#include <grpcpp/grpcpp.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace folly {
+
+class EventBase;
+
+} // namespace folly
+
+namespace fservice {
+
+struct IServerEventHandler;
+
+/* Grpc server based on the callback API. gRPC owns polling threads, requests
+ * are handled in the event loops round-robin. */
+class CallbackServer final : public IServer {
+ public:
+  CallbackServer(std::vector<folly::EventBase*> eventLoops,
+                 IServerEventHandler& serverEventHandler,
+                 ServerConfig const& config = {});
+
+  ~CallbackServer() override;
+
+  void runAsync(std::string const& address) override;
+
+  void addStats(ServerStats& stats) const override;
+
+  /* Calls are passed to the event loops directly, nothing waits here. */
+  bool processEvents(std::size_t& budget,
+                     std::chrono::steady_clock::time_point deadline) override;
+
+  void shutdown(std::chrono::milliseconds drainTimeout) override;
+
+ private:
+  class GreeterService final : public Greeter::CallbackService {
+   public:
+    explicit GreeterService(CallbackServer& server);
+
+    grpc::ServerUnaryReactor* SayHello(grpc::CallbackServerContext* context,
+                                       HelloRequest const* request,
+                                       HelloReply* reply) override;
+
+    grpc::ServerBidiReactor<HelloRequest, HelloReply>* SayHelloStream(
+        grpc::CallbackServerContext* context) override;
+
+    grpc::ServerUnaryReactor* SayHelloBatch(
+        grpc::CallbackServerContext* context,
+        HelloBatchRequest const* request,
+        HelloBatchReply* reply) override;
+
+   private:
+    /* Pass unary call to the handler in the event loop. */
+    template <typename Request, typename Reply>
+    grpc::ServerUnaryReactor* dispatch(
+        grpc::CallbackServerContext* context,
+        Request const* request,
+        Reply* reply,
+        folly::SemiFuture<folly::Unit> (IServerEventHandler::*handleMethod)(
+            Request const&, Reply&),
+        Rpc rpc);
+
+    DECLARE_GET_LOGGER("CallbackServer.Greeter")
+
+    CallbackServer& server_;
+  };
+
+  /* Reactor of SayHelloStream call. Deletes itself when done. */
+  class StreamReactor final
+      : public grpc::ServerBidiReactor<HelloRequest, HelloReply>,
+        public HelloStreamSession {
+   public:
+    StreamReactor(folly::EventBase* eventLoop,
+                  IServerEventHandler* serverEventHandler,
+                  std::size_t maxPendingReplies,
+                  Metrics* metrics);
+
+    void OnReadDone(bool ok) override;
+
+    void OnWriteDone(bool ok) override;
+
+    void OnDone() override;
+
+   private:
+    void startRead() override;
+
+    void startWrite(HelloReply const& reply) override;
+
+    void finish(grpc::Status const& status) override;
+
+    void runInEventLoop(folly::Function<void()> task) override;
+
+    folly::EventBase* const eventLoop_;
+
+    Metrics* const metrics_;
+
+    /* When the stream was started. */
+    std::chrono::steady_clock::time_point const acceptedAt_;
+
+    /* Stream is finished with OK status. */
+    bool finishedOk_ = false;
+  };
+
+  DECLARE_GET_LOGGER("CallbackServer")
+
+  /* Pick event loop for the next request. */
+  folly::EventBase* nextEventLoop();
+
+  /* Status to finish the call with instead of handling or replying: client
+   * has cancelled the call or its deadline has passed. OK if the call is
+   * alive. */
+  static grpc::Status getAbortStatus(grpc::CallbackServerContext* context);
+
+  /* Finish unary call and count it. Its end is taken at Finish, the reactor
+   * of gRPC reports no completion of the write. */
+  void finishCall(grpc::ServerUnaryReactor* reactor,
+                  Rpc rpc,
+                  std::chrono::steady_clock::time_point acceptedAt,
+                  grpc::Status const& status);
+
+  /* Shards which handle requests. */
+  std::vector<folly::EventBase*> const eventLoops_;
+
+  IServerEventHandler& serverEventHandler_;
+
+  ServerConfig const config_;
+
+  /* Bounds unary calls which wait for or run in the event loops. */
+  AdmissionController admissionController_;
+
+  std::atomic<std::uint64_t> abortedCount_{0u};
+
+  /* Calls by method. */
+  Metrics metrics_;
+
+  std::atomic<std::size_t> nextEventLoopIndex_{0u};
+
+  GreeterService greeterService_;
+
+  std::unique_ptr<grpc::Server> grpcServer_;
+
+  bool stopped_ = false;
+};
+
+} // namespace fservice
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+namespace fservice {
+
+/**
+ * Object passed to gRPC as a tag of an async operation. Completion queue
+ * thread calls proceed() when the operation is completed.
+ */
+struct ICompletionTag {
+  virtual ~ICompletionTag() = default;
+
+  /**
+   * Handle completion of the operation.
+   * @param ok Operation result reported by the completion queue.
+   */
+  virtual void proceed(bool ok) = 0;
+
+  /**
+   * Get pointer to pass to gRPC. Completion queue thread casts it back to
+   * ICompletionTag.
+   */
+  void* tag() {
+    return this;
+  }
+};
+
+/**
+ * Tag which forwards completion to the member function of its owner. Allows
+ * one object to have several operations in flight, one tag per operation.
+ */
+template <typename T, void (T::*Method)(bool)>
+class MemberCompletionTag final : public ICompletionTag {
+ public:
+  explicit MemberCompletionTag(T* owner) : owner_(owner) {
+  }
+
+  void proceed(bool ok) override {
+    (owner_->*Method)(ok);
+  }
+
+ private:
+  T* const owner_;
+};
+
+} // namespace fservice
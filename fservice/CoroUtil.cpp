@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/CoroUtil.h>
+
+#if FOLLY_HAS_COROUTINES
+
+#include <folly/executors/InlineExecutor.h>
+#include <folly/io/async/EventBaseManager.h>
+
+#include <memory>
+#include <utility>
+
+namespace fservice {
+
+namespace {
+
+/* Timer callback which fulfills the promise when it fires or is cancelled. */
+class TimeoutPromise final : public folly::HHWheelTimer::Callback {
+ public:
+  folly::SemiFuture<folly::Unit> getSemiFuture() {
+    return promise_.getSemiFuture();
+  }
+
+  void timeoutExpired() noexcept override {
+    promise_.setValue();
+  }
+
+  void callbackCanceled() noexcept override {
+    promise_.setValue();
+  }
+
+ private:
+  folly::Promise<folly::Unit> promise_;
+};
+
+} // namespace
+
+folly::SemiFuture<folly::Unit> startHandler(folly::coro::Task<void> task,
+                                            folly::Executor* executor) {
+  auto* const currentEventLoop =
+      folly::EventBaseManager::get()->getExistingEventBase();
+  if (executor == nullptr) {
+    executor = currentEventLoop;
+  }
+  if (executor == nullptr) {
+    // Not in an event loop, run until the first suspension right here.
+    executor = &folly::InlineExecutor::instance();
+  }
+  auto scheduled =
+      std::move(task).scheduleOn(folly::getKeepAliveToken(executor));
+  if (executor == currentEventLoop ||
+      executor == &folly::InlineExecutor::instance()) {
+    // Already in the thread of the executor. Run until the first suspension
+    // right here, so the future of a handler which does not suspend is ready
+    // on return and the caller skips the event loop hop.
+    return std::move(scheduled).startInlineUnsafe();
+  }
+  return std::move(scheduled).start();
+}
+
+folly::coro::Task<void> sleepFor(folly::HHWheelTimer& timer,
+                                 std::chrono::milliseconds const duration) {
+  // Coroutine resumes through the executor of the same event loop, so the
+  // callback is not touched by the timer anymore when it is destroyed.
+  TimeoutPromise timeout;
+  auto expired = timeout.getSemiFuture();
+  timer.scheduleTimeout(&timeout, duration);
+  co_await std::move(expired);
+}
+
+folly::coro::Task<grpc::Status> callSayHello(Greeter::Stub& stub,
+                                             grpc::ClientContext& context,
+                                             HelloRequest const& request,
+                                             HelloReply& reply) {
+  // Completion callback must be copyable and may run after the coroutine
+  // has resumed, so the promise is shared.
+  auto promise = std::make_shared<folly::Promise<grpc::Status>>();
+  auto completed = promise->getSemiFuture();
+  stub.async()->SayHello(
+      &context, &request, &reply, [promise](grpc::Status status) {
+        promise->setValue(std::move(status));
+      });
+  co_return co_await std::move(completed);
+}
+
+} // namespace fservice
+
+#endif // FOLLY_HAS_COROUTINES
@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <folly/experimental/coro/Coroutine.h>
+
+#if FOLLY_HAS_COROUTINES
+
+#include <protos/Greeter.grpc.pb.h>
+
+#include <folly/Executor.h>
+#include <folly/Unit.h>
+#include <folly/experimental/coro/Task.h>
+#include <folly/futures/Future.h>
+#include <folly/io/async/HHWheelTimer.h>
+
+#include <grpcpp/grpcpp.h>
+
+#include <chrono>
+
+namespace fservice {
+
+/**
+ * Start handler coroutine and get the future of its completion, which is
+ * what IServerEventHandler async methods return. If executor is the event
+ * loop of the calling thread, the coroutine runs inline until it suspends,
+ * so the future of a coroutine which never suspends is ready on return.
+ * @param task Handler coroutine.
+ * @param executor Executor to run on. If null, the coroutine runs in the
+ * event loop of the calling thread, i.e. the loop the server has dispatched
+ * the call to.
+ */
+folly::SemiFuture<folly::Unit> startHandler(folly::coro::Task<void> task,
+                                            folly::Executor* executor);
+
+/**
+ * Suspend coroutine for the given time without blocking its event loop.
+ * Must be awaited in the thread of the timer's event loop.
+ */
+folly::coro::Task<void> sleepFor(folly::HHWheelTimer& timer,
+                                 std::chrono::milliseconds duration);
+
+/**
+ * Call SayHello of another Greeter server. Coroutine is suspended until the
+ * call completes, no thread is blocked meanwhile.
+ * @param stub Stub of the server.
+ * @param context Context of the call. Must outlive the call.
+ * @param request Request. Must outlive the call.
+ * @param reply Reply. Valid if returned status is OK.
+ * @return Status of the call.
+ */
+folly::coro::Task<grpc::Status> callSayHello(Greeter::Stub& stub,
+                                             grpc::ClientContext& context,
+                                             HelloRequest const& request,
+                                             HelloReply& reply);
+
+} // namespace fservice
+
+#endif // FOLLY_HAS_COROUTINES
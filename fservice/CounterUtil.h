@@ -0,0 +1,23 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace fservice {
+
+/**
+ * Add value to a counter which is written by one thread only. Plain load and
+ * store are enough then, readers in other threads see a recent value without
+ * the cost of read-modify-write.
+ */
+inline void incrementCounter(std::atomic<std::uint64_t>& counter,
+                             std::uint64_t const value) noexcept {
+  counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+}
+
+} // namespace fservice
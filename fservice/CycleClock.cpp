@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/CycleClock.h>
+
+#include <thread>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+namespace fservice {
+
+namespace {
+
+bool hasInvariantTsc() {
+#if defined(__x86_64__)
+  unsigned int eax = 0u;
+  unsigned int ebx = 0u;
+  unsigned int ecx = 0u;
+  unsigned int edx = 0u;
+  // Advanced power management leaf, EDX bit 8 is the invariant TSC.
+  if (__get_cpuid_max(0x80000000u, nullptr) < 0x80000007u ||
+      __get_cpuid(0x80000007u, &eax, &ebx, &ecx, &edx) == 0) {
+    return false;
+  }
+  return (edx & (1u << 8u)) != 0u;
+#else
+  return false;
+#endif
+}
+
+double measureNanosecondsPerTick() {
+  using namespace std::chrono_literals;
+  auto const startedAt = std::chrono::steady_clock::now();
+  auto const startTicks = CycleClock::now();
+  std::this_thread::sleep_for(10ms);
+  auto const ticks = CycleClock::now() - startTicks;
+  auto const elapsed = std::chrono::duration<double, std::nano>(
+      std::chrono::steady_clock::now() - startedAt);
+  return ticks > 0u ? elapsed.count() / static_cast<double>(ticks) : 1.0;
+}
+
+double getNanosecondsPerTick() {
+  static double const nanosecondsPerTick = measureNanosecondsPerTick();
+  return nanosecondsPerTick;
+}
+
+} // namespace
+
+bool const CycleClock::useTsc_ = hasInvariantTsc();
+
+std::uint64_t CycleClock::toNanoseconds(std::uint64_t const ticks) {
+  if (!useTsc_) {
+    // Fallback ticks are nanoseconds already.
+    return ticks;
+  }
+  return static_cast<std::uint64_t>(static_cast<double>(ticks) *
+                                    getNanosecondsPerTick());
+}
+
+void CycleClock::calibrate() {
+  if (useTsc_) {
+    getNanosecondsPerTick();
+  }
+}
+
+} // namespace fservice
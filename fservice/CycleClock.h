@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+namespace fservice {
+
+/**
+ * Cheap monotonic timestamps for timing of hot paths. Reads the TSC on
+ * x86-64 if it is invariant, so it ticks at constant rate and is in sync
+ * across cores, otherwise falls back to steady_clock. Ticks are converted to
+ * time only when durations are recorded. Thread safe.
+ */
+class CycleClock {
+ public:
+  /**
+   * Current time in ticks.
+   */
+  static std::uint64_t now() noexcept {
+#if defined(__x86_64__)
+    if (useTsc_) {
+      return __rdtsc();
+    }
+#endif
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+  }
+
+  /**
+   * Duration of ticks in nanoseconds.
+   */
+  static std::uint64_t toNanoseconds(std::uint64_t ticks);
+
+  /**
+   * Measure the tick rate. Takes a few milliseconds, so it is better done
+   * at startup than on the first conversion.
+   */
+  static void calibrate();
+
+ private:
+  /* Invariant TSC is available. */
+  static bool const useTsc_;
+};
+
+} // namespace fservice
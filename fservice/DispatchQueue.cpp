@@ -0,0 +1,219 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/CounterUtil.h>
+#include <fservice/DispatchQueue.h>
+#include <fservice/EnumUtil.h>
+
+#include <folly/io/async/EventBase.h>
+#include <folly/lang/Bits.h>
+
+#include <grpcpp/grpcpp.h>
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace fservice {
+
+template <>
+EnumStrings<Priority>::DataType EnumStrings<Priority>::data = {
+    "high", "normal", "low"};
+
+Priority getCallPriority(grpc::ServerContext const& context) {
+  auto const& metadata = context.client_metadata();
+  auto const it = metadata.find("x-priority");
+  if (it == metadata.end()) {
+    return Priority::Normal;
+  }
+  for (auto i = 0u; i < kPrioritiesCount; ++i) {
+    auto const priority = FromIntegral<Priority>(i);
+    if (it->second == EnumToChars(priority)) {
+      return priority;
+    }
+  }
+  return Priority::Normal;
+}
+
+DispatchQueue::DispatchQueue(folly::EventBase* eventLoop,
+                             Weights const& weights,
+                             std::size_t const laneCapacity,
+                             bool const manual)
+    : eventLoop_(eventLoop), manual_(manual) {
+  assert(eventLoop_ != nullptr);
+  for (auto i = 0u; i < kPrioritiesCount; ++i) {
+    lanes_[i] =
+        std::make_unique<Lane>(std::max<std::size_t>(1u, laneCapacity));
+    lanes_[i]->weight = std::max(1u, weights[i]);
+  }
+}
+
+void DispatchQueue::post(Priority priority, Task task) {
+  auto& lane = *lanes_[ToIntegral(priority)];
+  Item item{std::move(task), Clock::now()};
+  // Item is left intact if the write fails.
+  if (lane.overflowSize.load(std::memory_order_relaxed) != 0u ||
+      !lane.items.write(std::move(item))) {
+    // Ring is full. Take the slow path, the task still obeys lane weights
+    // and the budget of manual drain.
+    lane.overflowed.fetch_add(1u, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> const lock(lane.overflowMutex);
+    lane.overflowItems.push_back(std::move(item));
+    lane.overflowSize.store(lane.overflowItems.size(),
+                            std::memory_order_relaxed);
+  }
+  schedule();
+}
+
+void DispatchQueue::runInLoop(Priority priority, Task task) {
+  if (manual_) {
+    post(priority, std::move(task));
+    return;
+  }
+  eventLoop_->runInEventBaseThread(std::move(task));
+}
+
+folly::EventBase* DispatchQueue::getEventLoop() const {
+  return eventLoop_;
+}
+
+LaneStats DispatchQueue::getLaneStats(Priority priority) const {
+  auto const& lane = *lanes_[ToIntegral(priority)];
+  LaneStats stats;
+  stats.depth = static_cast<std::uint64_t>(
+                    std::max<std::ptrdiff_t>(0, lane.items.sizeGuess())) +
+                lane.overflowSize.load(std::memory_order_relaxed);
+  stats.overflowed = lane.overflowed.load(std::memory_order_relaxed);
+  stats.dispatched = lane.dispatched.load(std::memory_order_relaxed);
+  stats.waitTimeUs = lane.waitTimeUs.load(std::memory_order_relaxed);
+  stats.maxWaitTimeUs = lane.maxWaitTimeUs.load(std::memory_order_relaxed);
+  return stats;
+}
+
+DispatchQueue::BatchSizes DispatchQueue::getBatchSizes() const {
+  BatchSizes batchSizes;
+  for (auto i = 0u; i < batchSizes.size(); ++i) {
+    batchSizes[i] = batchSizes_[i].load(std::memory_order_relaxed);
+  }
+  return batchSizes;
+}
+
+void DispatchQueue::schedule() {
+  if (scheduled_.exchange(true)) {
+    return;
+  }
+  if (manual_) {
+    // Owner of the loop drains once the loop iteration is over.
+    eventLoop_->runInEventBaseThread([]() {});
+    return;
+  }
+  // Queue stays alive until the posted drain has run.
+  eventLoop_->runInEventBaseThread(
+      [self = shared_from_this()]() { self->drainPosted(); });
+}
+
+bool DispatchQueue::drain(std::size_t& budget,
+                          std::chrono::steady_clock::time_point deadline) {
+  if (budget == 0u) {
+    // Nothing is run, so the pending wakeup is kept.
+    return hasTasks();
+  }
+  // Tasks posted from now on need another wakeup. Exchange, not store, so
+  // tasks written before the last schedule are visible below.
+  scheduled_.exchange(false);
+  while (budget > 0u) {
+    auto const maxTasks = std::min(budget, kMaxTasksPerWakeup);
+    auto const tasksCount = runBatch(maxTasks);
+    budget -= tasksCount;
+    if (tasksCount < maxTasks) {
+      return false;
+    }
+    if (Clock::now() >= deadline) {
+      break;
+    }
+  }
+  return true;
+}
+
+void DispatchQueue::drainPosted() {
+  scheduled_.exchange(false);
+  if (runBatch(kMaxTasksPerWakeup) == kMaxTasksPerWakeup) {
+    // Lanes may have more. Let other events of the loop run before the
+    // next batch.
+    schedule();
+  }
+}
+
+std::size_t DispatchQueue::runBatch(std::size_t const maxTasks) {
+  assert(maxTasks <= kMaxTasksPerWakeup);
+  // Take one batch in weighted rounds, then run it.
+  std::array<Item, kMaxTasksPerWakeup> batch;
+  std::array<Lane*, kMaxTasksPerWakeup> batchLanes;
+  auto batchSize = 0u;
+  auto taken = true;
+  while (taken && batchSize < maxTasks) {
+    taken = false;
+    for (auto& lane : lanes_) {
+      for (auto i = 0u; i < lane->weight && batchSize < maxTasks &&
+                        take(*lane, batch[batchSize]);
+           ++i) {
+        batchLanes[batchSize++] = lane.get();
+        taken = true;
+      }
+    }
+  }
+  if (batchSize == 0u) {
+    return 0u;
+  }
+
+  auto const bucket = std::min<std::size_t>(
+      folly::findLastSet(batchSize) - 1u, kBatchSizeBuckets - 1u);
+  incrementCounter(batchSizes_[bucket], 1u);
+
+  // Wait lasts until the task starts, tasks ahead in the batch included.
+  auto startedAt = Clock::now();
+  for (auto i = 0u; i < batchSize; ++i) {
+    auto& lane = *batchLanes[i];
+    auto const waitTimeUs = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            startedAt - batch[i].enqueuedAt)
+            .count());
+    incrementCounter(lane.dispatched, 1u);
+    incrementCounter(lane.waitTimeUs, waitTimeUs);
+    if (waitTimeUs > lane.maxWaitTimeUs.load(std::memory_order_relaxed)) {
+      lane.maxWaitTimeUs.store(waitTimeUs, std::memory_order_relaxed);
+    }
+    batch[i].task();
+    startedAt = Clock::now();
+  }
+  return batchSize;
+}
+
+bool DispatchQueue::hasTasks() const {
+  return std::any_of(lanes_.begin(), lanes_.end(), [](auto const& lane) {
+    return lane->items.sizeGuess() > 0 ||
+           lane->overflowSize.load(std::memory_order_relaxed) != 0u;
+  });
+}
+
+bool DispatchQueue::take(Lane& lane, Item& item) {
+  // Ring holds older tasks than the overflow list.
+  if (lane.items.read(item)) {
+    return true;
+  }
+  if (lane.overflowSize.load(std::memory_order_relaxed) == 0u) {
+    return false;
+  }
+  std::lock_guard<std::mutex> const lock(lane.overflowMutex);
+  if (lane.overflowItems.empty()) {
+    return false;
+  }
+  item = std::move(lane.overflowItems.front());
+  lane.overflowItems.pop_front();
+  lane.overflowSize.store(lane.overflowItems.size(),
+                          std::memory_order_relaxed);
+  return true;
+}
+
+} // namespace fservice
@@ -0,0 +1,195 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <fservice/Logger.h>
+#include <fservice/Priority.h>
+#include <fservice/ServerStats.h>
+
+#include <folly/Function.h>
+#include <folly/MPMCQueue.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace folly {
+
+class EventBase;
+
+} // namespace folly
+
+namespace grpc {
+
+class ServerContext;
+
+} // namespace grpc
+
+namespace fservice {
+
+/**
+ * Get priority of the call from client metadata. Normal if not set or
+ * unknown.
+ */
+Priority getCallPriority(grpc::ServerContext const& context);
+
+/**
+ * Queue of tasks of one event loop split into priority lanes. Each lane is a
+ * bounded lock-free ring, so queue threads hand calls over without locks or
+ * allocations. Lanes are drained in batches: each round takes up to weight
+ * tasks from each lane, so low priority tasks are delayed but never starved.
+ * The event loop is woken up once per batch of posted tasks. Thread safe.
+ *
+ * Lanes are FIFO, not ordered earliest deadline first: a deadline heap would
+ * need a lock on the post path. Calls whose deadline passed while queued are
+ * dropped when they start instead, see UnaryCallData.
+ *
+ * In manual mode the queue only wakes the event loop up, and the owner of
+ * the loop runs the tasks by calling drain between loop iterations. Work of
+ * calls which enters the loop through runInLoop is run by drain too. Timers
+ * and I/O of the loop itself are not counted.
+ */
+class DispatchQueue : public std::enable_shared_from_this<DispatchQueue> {
+ public:
+  using Task = folly::Function<void()>;
+
+  using Weights = LaneWeights;
+
+  using BatchSizes = std::array<std::uint64_t, kBatchSizeBuckets>;
+
+  /**
+   * Create queue.
+   * @param eventLoop Event loop which runs the tasks.
+   * @param weights Tasks taken from each lane per round, by Priority.
+   * @param laneCapacity Capacity of the ring of each lane. Tasks posted to a
+   * full lane wait in its locked overflow list.
+   * @param manual Tasks are run by drain only.
+   */
+  DispatchQueue(folly::EventBase* eventLoop,
+                Weights const& weights,
+                std::size_t laneCapacity,
+                bool manual = false);
+
+  DispatchQueue(DispatchQueue const&) = delete;
+  DispatchQueue& operator=(DispatchQueue const&) = delete;
+
+  /**
+   * Enqueue task to run in the event loop.
+   */
+  void post(Priority priority, Task task);
+
+  /**
+   * Run task in the event loop without queueing it in the lanes, e.g. the
+   * continuation of a call which has been dispatched already. In manual mode
+   * the task is posted to the lane instead, so it counts against the budget
+   * of drain.
+   */
+  void runInLoop(Priority priority, Task task);
+
+  /**
+   * Run queued tasks in batches until the lanes are empty, budget is spent
+   * or deadline has passed. Must be called in the thread of the event loop.
+   * @param budget Max number of tasks to run. Decreased by the number of
+   * tasks run.
+   * @param deadline Time to stop after the current batch.
+   * @return True if tasks may be left.
+   */
+  bool drain(std::size_t& budget,
+             std::chrono::steady_clock::time_point deadline);
+
+  /**
+   * Event loop which runs the tasks.
+   */
+  folly::EventBase* getEventLoop() const;
+
+  /**
+   * Get counters of the lane.
+   */
+  LaneStats getLaneStats(Priority priority) const;
+
+  /**
+   * Number of drained batches by size, bucket i counts sizes in
+   * [2^i, 2^(i+1)).
+   */
+  BatchSizes getBatchSizes() const;
+
+ private:
+  DECLARE_GET_LOGGER("DispatchQueue")
+
+  using Clock = std::chrono::steady_clock;
+
+  /* Tasks run per wakeup, so other events of the loop are not delayed. */
+  static constexpr std::size_t kMaxTasksPerWakeup = 64u;
+
+  struct Item {
+    Task task;
+    Clock::time_point enqueuedAt;
+  };
+
+  struct Lane {
+    explicit Lane(std::size_t capacity) : items(capacity) {
+    }
+
+    folly::MPMCQueue<Item> items;
+
+    std::uint32_t weight = 1u;
+
+    /* Tasks which found the ring full. */
+    std::atomic<std::uint64_t> overflowed{0u};
+
+    /* Overflowed tasks, taken once the ring is empty. While the list is not
+     * empty new tasks are appended to it too, so they keep their order. */
+    std::mutex overflowMutex;
+
+    std::deque<Item> overflowItems;
+
+    /* Size of overflowItems, read without the lock. */
+    std::atomic<std::size_t> overflowSize{0u};
+
+    /* Written by the event loop only. */
+    std::atomic<std::uint64_t> dispatched{0u};
+
+    std::atomic<std::uint64_t> waitTimeUs{0u};
+
+    std::atomic<std::uint64_t> maxWaitTimeUs{0u};
+  };
+
+  /* Run one batch of tasks in the event loop. Posted by schedule. */
+  void drainPosted();
+
+  /* Take up to maxTasks in weighted rounds and run them.
+   * @return Number of tasks run. */
+  std::size_t runBatch(std::size_t maxTasks);
+
+  /* Some lane has tasks. A hint, posts and drains may run concurrently. */
+  bool hasTasks() const;
+
+  /* Take the oldest task of the lane, from the ring or the overflow list. */
+  static bool take(Lane& lane, Item& item);
+
+  /* Ask the event loop to drain, or just wake it up in manual mode, unless
+   * it is asked already. */
+  void schedule();
+
+  folly::EventBase* const eventLoop_;
+
+  bool const manual_;
+
+  /* Indexed by Priority. */
+  std::array<std::unique_ptr<Lane>, kPrioritiesCount> lanes_;
+
+  /* Written by the event loop only. */
+  std::array<std::atomic<std::uint64_t>, kBatchSizeBuckets> batchSizes_{};
+
+  /* Drain is posted to the event loop and has not started yet. */
+  std::atomic_bool scheduled_{false};
+};
+
+} // namespace fservice
@@ -4,24 +4,160 @@
 
 #include <fservice/Engine.h>
 
+#include <fservice/AdminServer.h>
 #include <fservice/AsyncServer.h>
+#include <fservice/CallbackServer.h>
+#include <fservice/DispatchQueue.h>
+#include <fservice/EnumUtil.h>
+#include <fservice/HelloWireFormat.h>
 #include <fservice/IEngineEventHandler.h>
+#include <fservice/PrometheusFormat.h>
 #include <fservice/RepeatableTimeout.h>
+#include <protos/Admin.pb.h>
 #include <protos/Greeter.grpc.pb.h>
 
+#include <folly/Executor.h>
+#include <folly/executors/IOThreadPoolExecutor.h>
+#include <folly/futures/Future.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/HHWheelTimer.h>
 
+#include <fmt/format.h>
+
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <string>
 #include <utility>
+#include <vector>
 
 namespace fservice {
 
-Engine::Engine(folly::SocketAddress address,
+namespace {
+
+std::unique_ptr<IServer> makeServer(std::vector<folly::EventBase*> eventLoops,
+                                    IServerEventHandler& serverEventHandler,
+                                    ServerConfig const& config) {
+  switch (config.backend) {
+    case ServerBackend::Callback:
+      return std::make_unique<CallbackServer>(
+          std::move(eventLoops), serverEventHandler, config);
+    case ServerBackend::CompletionQueue:
+      break;
+  }
+  return std::make_unique<AsyncServer>(
+      std::move(eventLoops), serverEventHandler, config);
+}
+
+/* Share of listener index when total is split between count listeners.
+ * First listeners take the remainder. */
+std::uint32_t getListenerShare(std::uint32_t const total,
+                               std::uint32_t const count,
+                               std::uint32_t const index) {
+  return total / count + (index < total % count ? 1u : 0u);
+}
+
+std::vector<std::unique_ptr<IServer>> makeServers(
+    std::vector<folly::EventBase*> const& eventLoops,
+    IServerEventHandler& serverEventHandler,
+    ServerConfig const& config) {
+  assert(!eventLoops.empty());
+  auto const listenersCount = std::max(1u, config.listenersCount);
+
+  std::vector<std::unique_ptr<IServer>> servers;
+  auto firstQueue = 0u;
+  for (auto i = 0u; i < listenersCount; ++i) {
+    // Queues and limits are split, so listeners together match the config.
+    // A listener needs at least one queue, and a limit of 0 means no limit.
+    auto listenerConfig = config;
+    listenerConfig.queuesCount =
+        std::max(1u, getListenerShare(config.queuesCount, listenersCount, i));
+    if (config.maxInFlight > 0u) {
+      listenerConfig.maxInFlight = std::max(
+          1u, getListenerShare(config.maxInFlight, listenersCount, i));
+    }
+    if (config.cacheCapacity > 0u) {
+      listenerConfig.cacheCapacity = std::max(
+          1u, getListenerShare(config.cacheCapacity, listenersCount, i));
+    }
+    if (listenersCount > 1u) {
+      // Otherwise the second listener fails to bind.
+      listenerConfig.transport.reusePort = true;
+    }
+    // Queue threads of each listener take the next cores of the list.
+    auto& queueCores = listenerConfig.placement.queueCores;
+    if (!queueCores.empty()) {
+      std::rotate(queueCores.begin(),
+                  queueCores.begin() + firstQueue % queueCores.size(),
+                  queueCores.end());
+    }
+    firstQueue += listenerConfig.queuesCount;
+    // Event loops are dealt round-robin, so listeners share no loop while
+    // there are enough of them.
+    std::vector<folly::EventBase*> listenerEventLoops;
+    for (auto j = i; j < eventLoops.size(); j += listenersCount) {
+      listenerEventLoops.push_back(eventLoops[j]);
+    }
+    if (listenerEventLoops.empty()) {
+      listenerEventLoops.push_back(eventLoops[i % eventLoops.size()]);
+    }
+    servers.push_back(makeServer(
+        std::move(listenerEventLoops), serverEventHandler, listenerConfig));
+  }
+  return servers;
+}
+
+/* Fill counters of reply. Call counters and latencies are counted since
+ * base, the others since start. */
+void fillStatsReply(ServerStats const& stats,
+                    Metrics::Snapshot const& base,
+                    StatsReply& reply) {
+  for (auto i = 0u; i < kRpcsCount; ++i) {
+    auto interval = stats.rpcs[i];
+    interval -= base[i];
+    auto& rpc = *reply.add_rpcs();
+    rpc.set_method(EnumToString(FromIntegral<Rpc>(i)));
+    rpc.set_accepted(interval.accepted);
+    rpc.set_completed(interval.completed);
+    rpc.set_failed(interval.failed);
+    rpc.set_in_flight(stats.rpcs[i].getInFlight());
+    auto& latency = *rpc.mutable_latency();
+    latency.set_count(interval.latency.getCount());
+    latency.set_p50_us(interval.latency.getPercentile(50.0));
+    latency.set_p90_us(interval.latency.getPercentile(90.0));
+    latency.set_p99_us(interval.latency.getPercentile(99.0));
+    latency.set_p999_us(interval.latency.getPercentile(99.9));
+    latency.set_max_us(interval.latency.getMax());
+  }
+  reply.set_shed_calls(stats.shedCalls);
+  reply.set_aborted_calls(stats.abortedCalls);
+  reply.set_cache_hits(stats.cacheHits);
+  reply.set_cache_misses(stats.cacheMisses);
+  reply.set_coalesced_calls(stats.coalescedCalls);
+  for (auto i = 0u; i < stats.lanes.size(); ++i) {
+    auto const& laneStats = stats.lanes[i];
+    auto& lane = *reply.add_lanes();
+    lane.set_priority(EnumToString(FromIntegral<Priority>(i)));
+    lane.set_depth(laneStats.depth);
+    lane.set_dispatched(laneStats.dispatched);
+    lane.set_overflowed(laneStats.overflowed);
+    lane.set_max_wait_us(laneStats.maxWaitTimeUs);
+  }
+}
+
+} // namespace
+
+Engine::Engine(StartupConfig startupConfig,
                folly::EventBase& mainEventBase,
+               folly::IOThreadPoolExecutor* ioThreadPool,
+               folly::Executor* cpuExecutor,
                IEngineEventHandler& engineEventHandler)
-    : address_(std::move(address)),
+    : startupConfig_(std::move(startupConfig)),
       mainEventBase_(mainEventBase),
+      ioThreadPool_(ioThreadPool),
+      cpuExecutor_(cpuExecutor),
       engineEventHandler_(engineEventHandler) {
   LOG_AUTO_TRACE();
   LOG_INFO("Engine has been created.");
@@ -31,6 +167,9 @@ Engine::~Engine() {
   LOG_AUTO_TRACE();
 
   stopped_ = true;
+  if (drainThread_.joinable()) {
+    drainThread_.join();
+  }
 
   LOG_INFO("Engine has been destroyed.");
 }
@@ -49,11 +188,40 @@ void Engine::start() {
       timer, [this]() { publishStats(); }, milliseconds(4000));
 
   stopped_ = false;
+  publishedAt_ = std::chrono::steady_clock::now();
 
-  server_ = std::make_unique<AsyncServer>(mainEventBase_, *this);
+  // Requests are handled in the IO pool shards. Main event base is left for
+  // lifecycle events and stats only. In tick mode the main thread runs them
+  // between its loop iterations instead.
+  std::vector<folly::EventBase*> eventLoops;
+  if (startupConfig_.runMode == RunMode::Tick) {
+    eventLoops.push_back(&mainEventBase_);
+  } else {
+    assert(ioThreadPool_ != nullptr);
+    for (auto& eventBase : ioThreadPool_->getAllEventBases()) {
+      eventLoops.push_back(eventBase.get());
+    }
+  }
 
-  server_->runAsync(
-      fmt::format("{}:{}", address_.getAddressStr(), address_.getPort()));
+  {
+    auto servers = makeServers(eventLoops, *this, startupConfig_.server);
+    std::lock_guard<std::mutex> const lock(serversMutex_);
+    servers_ = std::move(servers);
+  }
+
+  auto const& address = startupConfig_.address;
+  for (auto& server : servers_) {
+    server->runAsync(
+        fmt::format("{}:{}", address.getAddressStr(), address.getPort()));
+  }
+  LOG_INFOF("Started {} listener(s)", servers_.size());
+
+  if (startupConfig_.adminPort != 0u) {
+    resetAt_ = std::chrono::steady_clock::now();
+    adminServer_ = std::make_unique<AdminServer>(*this);
+    adminServer_->runAsync(fmt::format(
+        "{}:{}", address.getAddressStr(), startupConfig_.adminPort));
+  }
 
   LOG_INFO("Engine has been launched.");
   return;
@@ -70,11 +238,30 @@ void Engine::stop() {
   }
 
   stopped_ = true;
-  LOG_INFO("Stopping server");
-  server_.reset();
-  LOG_INFO("Stopped server");
-
-  mainEventBase_.runInLoop([this]() { engineEventHandler_.onEngineStopped(); });
+  LOG_INFO("Stopping servers");
+  // Stats keep being published while the servers drain.
+  drainThread_ = std::thread([this]() {
+    // Listeners drain in parallel, so the drain takes one timeout at most.
+    std::vector<std::thread> shutdownThreads;
+    for (auto& server : servers_) {
+      shutdownThreads.emplace_back([this, server = server.get()]() {
+        server->shutdown(startupConfig_.server.drainTimeout);
+      });
+    }
+    for (auto& shutdownThread : shutdownThreads) {
+      shutdownThread.join();
+    }
+    mainEventBase_.runInEventBaseThread([this]() {
+      // Admin calls read the servers.
+      adminServer_.reset();
+      {
+        std::lock_guard<std::mutex> const lock(serversMutex_);
+        servers_.clear();
+      }
+      LOG_INFO("Stopped servers");
+      engineEventHandler_.onEngineStopped();
+    });
+  });
 
   return;
 }
@@ -91,10 +278,174 @@ void Engine::publishStats() {
   LOG_AUTO_TRACE();
   assert(initiated_);
   LOG_INFO("Publishing periodical stats");
+  if (!servers_.empty()) {
+    auto const stats = collectStats();
+    LOG_INFOF("CallData slots: {}; pool exhausted: {}",
+              stats.callDataSlots,
+              stats.callDataPoolExhausted);
+    LOG_INFOF("Calls accepted: {}; shed: {}; in flight: {}; aborted: {}",
+              stats.acceptedCalls,
+              stats.shedCalls,
+              stats.inFlightCalls,
+              stats.abortedCalls);
+    LOG_INFOF("Cache hits: {}; misses: {}; evictions: {}; coalesced: {}",
+              stats.cacheHits,
+              stats.cacheMisses,
+              stats.cacheEvictions,
+              stats.coalescedCalls);
+    LOG_INFOF("Queues CPU time: {} us; spin: {} us; spin hits: {}; parks: {}",
+              stats.queueCpuTimeUs,
+              stats.queueSpinTimeUs,
+              stats.queueSpinHits,
+              stats.queueParks);
+    for (auto i = 0u; i < stats.lanes.size(); ++i) {
+      auto const& lane = stats.lanes[i];
+      LOG_INFOF("Lane {}: depth: {}; dispatched: {}; overflowed: {}; "
+                "avg wait: {} us; max wait: {} us",
+                EnumToChars(FromIntegral<Priority>(i)),
+                lane.depth,
+                lane.dispatched,
+                lane.overflowed,
+                lane.dispatched > 0u ? lane.waitTimeUs / lane.dispatched : 0u,
+                lane.maxWaitTimeUs);
+    }
+    // Bucket i counts sizes in [2^i, 2^(i+1)), the last one has no bound.
+    std::string batches;
+    for (auto i = 0u; i < kBatchSizeBuckets; ++i) {
+      auto const minSize = std::uint64_t{1u} << i;
+      auto const maxSize = (minSize << 1u) - 1u;
+      auto out = fmt::format_to(
+          std::back_inserter(batches), "{}{}", i == 0u ? "" : "; ", minSize);
+      if (i + 1u == kBatchSizeBuckets) {
+        out = fmt::format_to(out, "+");
+      } else if (maxSize != minSize) {
+        out = fmt::format_to(out, "-{}", maxSize);
+      }
+      fmt::format_to(out, ": {}", stats.dispatchBatches[i]);
+    }
+    LOG_INFOF("Dispatch batches: {}", batches);
+
+    auto const now = std::chrono::steady_clock::now();
+    for (auto i = 0u; i < kRpcsCount; ++i) {
+      auto interval = stats.rpcs[i];
+      interval -= publishedRpcs_[i];
+      publishRpcMetrics(FromIntegral<Rpc>(i),
+                        interval,
+                        stats.rpcs[i].getInFlight(),
+                        now - publishedAt_);
+    }
+    for (auto i = 0u; i < kStagesCount; ++i) {
+      auto interval = stats.stages[i];
+      interval -= publishedStages_[i];
+      publishStageMetrics(FromIntegral<Stage>(i), interval);
+    }
+    publishedRpcs_ = stats.rpcs;
+    publishedStages_ = stats.stages;
+    publishedAt_ = now;
+  }
+}
+
+ServerStats Engine::collectStats() const {
+  ServerStats stats;
+  std::lock_guard<std::mutex> const lock(serversMutex_);
+  for (auto const& server : servers_) {
+    server->addStats(stats);
+  }
+  return stats;
 }
 
-// void Engine::processEvents() {
-// }
+void Engine::onGetStats(GetStatsRequest const& request, StatsReply& reply) {
+  LOG_AUTO_TRACE();
+  auto const stats = collectStats();
+  reply.set_interval_seconds(std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() - resetAt_)
+                                 .count());
+  fillStatsReply(stats, resetRpcs_, reply);
+  if (request.prometheus_text()) {
+    // Scrapers take a drop of a counter for a restart, so the exposition
+    // counts since start and ResetStats leaves it alone.
+    static Metrics::Snapshot const start;
+    StatsReply sinceStart;
+    fillStatsReply(stats, start, sinceStart);
+    reply.set_prometheus_text(formatPrometheus(sinceStart));
+  }
+}
+
+void Engine::onGetConfig(GetConfigRequest const&, ConfigReply& reply) {
+  LOG_AUTO_TRACE();
+  for (auto& [name, value] : getOptions(startupConfig_)) {
+    (*reply.mutable_options())[name] = std::move(value);
+  }
+}
+
+void Engine::onResetStats(ResetStatsRequest const&, ResetStatsReply&) {
+  LOG_AUTO_TRACE();
+  LOG_INFO("Resetting call stats");
+  resetRpcs_ = collectStats().rpcs;
+  resetAt_ = std::chrono::steady_clock::now();
+}
+
+void Engine::publishRpcMetrics(Rpc const rpc,
+                               RpcMetrics const& interval,
+                               std::uint64_t const inFlight,
+                               std::chrono::duration<double> const elapsed) {
+  if (interval.accepted == 0u && interval.latency.getCount() == 0u &&
+      inFlight == 0u) {
+    return;
+  }
+  auto const& latency = interval.latency;
+  LOG_INFOF("{}: {:.1f} calls/s; accepted: {}; completed: {}; failed: {}; "
+            "in flight: {}",
+            EnumToChars(rpc),
+            elapsed.count() > 0.0 ? interval.accepted / elapsed.count() : 0.0,
+            interval.accepted,
+            interval.completed,
+            interval.failed,
+            inFlight);
+  LOG_INFOF("{} latency: p50: {} us; p90: {} us; p99: {} us; p999: {} us; "
+            "max: {} us",
+            EnumToChars(rpc),
+            latency.getPercentile(50.0),
+            latency.getPercentile(90.0),
+            latency.getPercentile(99.0),
+            latency.getPercentile(99.9),
+            latency.getMax());
+}
+
+void Engine::publishStageMetrics(Stage const stage,
+                                 LatencyHistogram const& interval) {
+  if (interval.getCount() == 0u) {
+    return;
+  }
+  LOG_INFOF("Stage {}: calls: {}; p50: {} ns; p90: {} ns; p99: {} ns; "
+            "p999: {} ns; max: {} ns",
+            EnumToChars(stage),
+            interval.getCount(),
+            interval.getPercentile(50.0),
+            interval.getPercentile(90.0),
+            interval.getPercentile(99.0),
+            interval.getPercentile(99.9),
+            interval.getMax());
+}
+
+bool Engine::processEvents() {
+  assert(initiated_);
+  if (servers_.empty()) {
+    return false;
+  }
+  auto budget = startupConfig_.tickBudget;
+  auto const deadline =
+      std::chrono::steady_clock::now() + startupConfig_.tickTimeSlice;
+  // Start from the next server each tick, so a busy listener which spends
+  // the budget does not starve the others.
+  auto pending = false;
+  for (auto i = 0u; i < servers_.size(); ++i) {
+    auto& server = *servers_[(nextServer_ + i) % servers_.size()];
+    pending = server.processEvents(budget, deadline) || pending;
+  }
+  nextServer_ = (nextServer_ + 1u) % servers_.size();
+  return pending;
+}
 
 void Engine::onSayHello(HelloRequest const& request, HelloReply& reply) {
   LOG_AUTO_TRACE();
@@ -103,4 +454,79 @@ void Engine::onSayHello(HelloRequest const& request, HelloReply& reply) {
   reply.set_message(prefix + request.name());
 }
 
+void Engine::onSayHelloBatch(HelloBatchRequest const& request,
+                             HelloBatchReply& reply) {
+  LOG_AUTO_TRACE();
+  LOG_INFOF("Got batch of {} message(s)", request.requests_size());
+  auto const prefix = std::string{"Hello "};
+  auto& replies = *reply.mutable_replies();
+  replies.Reserve(request.requests_size());
+  for (auto const& item : request.requests()) {
+    auto& message = *replies.Add()->mutable_message();
+    message.reserve(prefix.size() + item.name().size());
+    message.append(prefix).append(item.name());
+  }
+}
+
+folly::SemiFuture<folly::Unit> Engine::onSayHelloAsync(
+    HelloRequest const& request, HelloReply& reply) {
+#if FOLLY_HAS_COROUTINES
+  return startHandler(coSayHello(request, reply), cpuExecutor_);
+#else
+  if (cpuExecutor_ == nullptr) {
+    return IServerEventHandler::onSayHelloAsync(request, reply);
+  }
+  return folly::via(folly::getKeepAliveToken(cpuExecutor_),
+                    [this, &request, &reply]() { onSayHello(request, reply); })
+      .semi();
+#endif
+}
+
+folly::SemiFuture<folly::Unit> Engine::onSayHelloBatchAsync(
+    HelloBatchRequest const& request, HelloBatchReply& reply) {
+#if FOLLY_HAS_COROUTINES
+  return startHandler(coSayHelloBatch(request, reply), cpuExecutor_);
+#else
+  if (cpuExecutor_ == nullptr) {
+    return IServerEventHandler::onSayHelloBatchAsync(request, reply);
+  }
+  return folly::via(
+             folly::getKeepAliveToken(cpuExecutor_),
+             [this, &request, &reply]() { onSayHelloBatch(request, reply); })
+      .semi();
+#endif
+}
+
+#if FOLLY_HAS_COROUTINES
+folly::coro::Task<void> Engine::coSayHello(HelloRequest const& request,
+                                           HelloReply& reply) {
+  onSayHello(request, reply);
+  co_return;
+}
+
+folly::coro::Task<void> Engine::coSayHelloBatch(
+    HelloBatchRequest const& request, HelloBatchReply& reply) {
+  onSayHelloBatch(request, reply);
+  co_return;
+}
+#endif
+
+grpc::Status Engine::onRawCall(std::string const& method,
+                               grpc::ByteBuffer& request,
+                               grpc::ByteBuffer& reply) {
+  LOG_AUTO_TRACE();
+  if (method != getSayHelloMethodName()) {
+    return IServerEventHandler::onRawCall(method, request, reply);
+  }
+
+  std::string name;
+  if (!readHelloRequestName(request, name)) {
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                        "Malformed HelloRequest");
+  }
+  LOG_INFOF("Got raw message: {}", name);
+  reply = makeHelloReply("Hello ", name);
+  return grpc::Status::OK;
+}
+
 } // namespace fservice
\ No newline at end of file
@@ -4,38 +4,60 @@
 
 #pragma once
 
+#include <fservice/CoroUtil.h>
+#include <fservice/IAdminEventHandler.h>
 #include <fservice/IServerEventHandler.h>
 #include <fservice/Logger.h>
-
-#include <folly/SocketAddress.h>
+#include <fservice/Metrics.h>
+#include <fservice/StartupConfig.h>
 
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace folly {
 
 class EventBase;
 
+class Executor;
+
+class IOThreadPoolExecutor;
+
 } // namespace folly
 
 namespace fservice {
 
+class AdminServer;
+
 class RepeatableTimeout;
 
-class AsyncServer;
+struct IServer;
 
 struct IEngineEventHandler;
 
 /**
  * Implementation of Engine. Holds all and runs all business logic.
  */
-class Engine final : public IServerEventHandler {
+class Engine final : public IServerEventHandler, public IAdminEventHandler {
  public:
   /**
    * Creates instance of Engine.
-   * @param address Engine address.
+   * @param startupConfig Engine configuration.
+   * @param mainEventBase Event loop for lifecycle events and stats.
+   * @param ioThreadPool Pool of event loops which handle requests. Null in
+   * tick run mode, where the main event loop handles them.
+   * @param cpuExecutor Executor of request handlers. Null to run them in the
+   * event loops.
+   * @param engineEventHandler Receiver of Engine lifecycle events.
    */
-  explicit Engine(folly::SocketAddress address,
+  explicit Engine(StartupConfig startupConfig,
                   folly::EventBase& mainEventBase,
+                  folly::IOThreadPoolExecutor* ioThreadPool,
+                  folly::Executor* cpuExecutor,
                   IEngineEventHandler& engineEventHandler);
 
   Engine& operator=(Engine const&) = delete;
@@ -54,7 +76,8 @@ class Engine final : public IServerEventHandler {
   void start();
 
   /**
-   * Trigger stop sequence. Non-blocking.
+   * Trigger stop sequence. Non-blocking. Server is drained in background,
+   * IEngineEventHandler::onEngineStopped is called when it is done.
    */
   void stop();
 
@@ -64,28 +87,109 @@ class Engine final : public IServerEventHandler {
    */
   bool init();
 
-  // void processEvents();
+  /**
+   * Run one tick of queued calls: up to tickBudget calls, taking no new
+   * batch after tickTimeSlice. Tick run mode only. Must be called in the
+   * thread of the main event loop, between its iterations.
+   * @return True if calls are left for the next tick.
+   */
+  bool processEvents();
 
   void onSayHello(HelloRequest const& request, HelloReply& reply) override;
 
+  void onSayHelloBatch(HelloBatchRequest const& request,
+                       HelloBatchReply& reply) override;
+
+  folly::SemiFuture<folly::Unit> onSayHelloAsync(HelloRequest const& request,
+                                                 HelloReply& reply) override;
+
+  folly::SemiFuture<folly::Unit> onSayHelloBatchAsync(
+      HelloBatchRequest const& request, HelloBatchReply& reply) override;
+
+  grpc::Status onRawCall(std::string const& method,
+                         grpc::ByteBuffer& request,
+                         grpc::ByteBuffer& reply) override;
+
+  void onGetStats(GetStatsRequest const& request, StatsReply& reply) override;
+
+  void onGetConfig(GetConfigRequest const& request,
+                   ConfigReply& reply) override;
+
+  void onResetStats(ResetStatsRequest const& request,
+                    ResetStatsReply& reply) override;
+
  private:
   DECLARE_GET_LOGGER("Engine")
 
   void publishStats();
 
+  /* Sum stats of the servers. Thread safe. */
+  ServerStats collectStats() const;
+
+  /* Log calls of one method over the last stats interval. */
+  void publishRpcMetrics(Rpc rpc,
+                         RpcMetrics const& interval,
+                         std::uint64_t inFlight,
+                         std::chrono::duration<double> elapsed);
+
+  /* Log time unary calls spent in one stage over the last stats interval. */
+  void publishStageMetrics(Stage stage, LatencyHistogram const& interval);
+
+#if FOLLY_HAS_COROUTINES
+  /* Handlers written as coroutines. They may suspend on timers (sleepFor)
+   * and outbound calls (callSayHello) without blocking the event loop. */
+  folly::coro::Task<void> coSayHello(HelloRequest const& request,
+                                     HelloReply& reply);
+
+  folly::coro::Task<void> coSayHelloBatch(HelloBatchRequest const& request,
+                                          HelloBatchReply& reply);
+#endif
+
   bool initiated_ = false;
 
-  folly::SocketAddress const address_;
+  StartupConfig const startupConfig_;
 
   std::atomic_bool stopped_ = false;
 
   folly::EventBase& mainEventBase_;
 
+  folly::IOThreadPoolExecutor* const ioThreadPool_;
+
+  /* Runs handlers off the event loops. Optional. */
+  folly::Executor* const cpuExecutor_;
+
   IEngineEventHandler& engineEventHandler_;
 
   std::unique_ptr<RepeatableTimeout> timeout_;
 
-  std::unique_ptr<AsyncServer> server_;
+  /* Call metrics of all servers at the last publishStats. Each interval is
+   * the difference with them, so counters are never reset under writers. */
+  Metrics::Snapshot publishedRpcs_;
+
+  Metrics::StagesSnapshot publishedStages_;
+
+  std::chrono::steady_clock::time_point publishedAt_;
+
+  /* Guards servers_ against the admin thread. The main thread changes
+   * servers_, so it reads them without the lock. */
+  mutable std::mutex serversMutex_;
+
+  /* Listeners sharing the address with SO_REUSEPORT. */
+  std::vector<std::unique_ptr<IServer>> servers_;
+
+  /* Server processEvents starts the next tick from. */
+  std::size_t nextServer_ = 0u;
+
+  /* Call metrics at the last ResetStats. Touched only by the admin thread. */
+  Metrics::Snapshot resetRpcs_;
+
+  std::chrono::steady_clock::time_point resetAt_;
+
+  /* Serves Admin calls in its own thread. Null if disabled. */
+  std::unique_ptr<AdminServer> adminServer_;
+
+  /* Drains the servers, so the main event loop keeps running meanwhile. */
+  std::thread drainThread_;
 };
 
 } // namespace fservice
@@ -4,11 +4,14 @@
 
 #include <fservice/Engine.h>
 #include <fservice/EngineLauncher.h>
+#include <fservice/EnumUtil.h>
 #include <fservice/ScopeGuard.h>
 #include <fservice/SignalHandler.h>
+#include <fservice/ThreadPlacement.h>
 
 #include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/executors/GlobalExecutor.h>
+#include <folly/executors/IOThreadPoolExecutor.h>
 #include <folly/io/async/EventBaseManager.h>
 
 #include <csignal>
@@ -22,7 +25,6 @@ EngineLauncher::EngineLauncher(StartupConfig startupConfig)
 void EngineLauncher::onTerminationRequest() {
   LOG_INFO("Termination request received. Stopping.");
   stopped_ = true;
-  mainEventBase_->terminateLoopSoon();
   engine_->stop();
 }
 
@@ -33,30 +35,56 @@ void EngineLauncher::onEngineStarted() {
 
 void EngineLauncher::onEngineStopped() {
   LOG_INFO("Engine stopped");
+  // Server is drained, nothing is left to wait for.
+  engineStopped_ = true;
+  mainEventBase_->terminateLoopSoon();
 }
 
 std::error_code EngineLauncher::init() {
   LOG_AUTO_TRACE();
 
-  LOG_INFOF("Address: {}:{}; Threads: {}",
+  LOG_INFOF("Address: {}:{}; Threads: {}; Backend: {}; Run mode: {}",
             startupConfig_.address.getAddressStr(),
             startupConfig_.address.getPort(),
-            startupConfig_.threadsCount);
+            startupConfig_.threadsCount,
+            EnumToString(startupConfig_.server.backend),
+            EnumToString(startupConfig_.runMode));
 
   signalHandler_ =
       std::make_unique<SignalHandler>([this]() { onTerminationRequest(); });
   signalHandler_->install({SIGINT, SIGTERM});
 
-  // Setup CPU executor
-  // auto cpuThreadExecutor = std::make_shared<folly::CPUThreadPoolExecutor>(
-  //     startupConfig_.threadsCount,
-  //     std::make_shared<folly::NamedThreadFactory>("CPUThread"));
-  // folly::setCPUExecutor(cpuThreadExecutor);
+  // Threads of the pools below are placed as they start.
+  auto const& placement = startupConfig_.server.placement;
+
+  // Setup CPU executor. Handlers run there, so heavy ones don't block the
+  // event loops.
+  if (startupConfig_.cpuThreadsCount > 0u) {
+    cpuThreadPool_ = std::make_shared<folly::CPUThreadPoolExecutor>(
+        startupConfig_.cpuThreadsCount,
+        std::make_shared<PlacedThreadFactory>(
+            "CPUThread", placement.cpuPoolCores, placement.localMemory));
+    folly::setCPUExecutor(cpuThreadPool_);
+    LOG_INFOF("Handlers run in {} CPU thread(s)",
+              startupConfig_.cpuThreadsCount);
+  }
 
   mainEventBase_ = folly::EventBaseManager::get()->getEventBase();
 
-  engine_ =
-      std::make_unique<Engine>(startupConfig_.address, *mainEventBase_, *this);
+  // One event loop per thread. Requests are sharded across them. In tick
+  // mode the main event loop handles them instead.
+  if (startupConfig_.runMode != RunMode::Tick) {
+    ioThreadPool_ = std::make_unique<folly::IOThreadPoolExecutor>(
+        startupConfig_.threadsCount,
+        std::make_shared<PlacedThreadFactory>(
+            "IOThread", placement.eventLoopCores, placement.localMemory));
+  }
+
+  engine_ = std::make_unique<Engine>(startupConfig_,
+                                     *mainEventBase_,
+                                     ioThreadPool_.get(),
+                                     cpuThreadPool_.get(),
+                                     *this);
 
   auto const initiated = engine_->init();
   return initiated ? GeneralError::Success : GeneralError::StartupFailed;
@@ -64,6 +92,9 @@ std::error_code EngineLauncher::init() {
 
 void EngineLauncher::deInit() {
   LOG_AUTO_TRACE();
+  engine_.reset();
+  cpuThreadPool_.reset();
+  ioThreadPool_.reset();
   mainEventBase_ = nullptr;
 }
 
@@ -73,13 +104,26 @@ std::error_code EngineLauncher::doRun() {
 
   engine_->start();
 
+  // Main thread runs the lifecycle loop. It is pinned once the threads of
+  // the engine are spawned, so they don't inherit its cores. Process keeps
+  // its name.
+  auto const& placement = startupConfig_.server.placement;
+  pinCurrentThread(placement.mainCores, 0u, placement.localMemory);
+
   LOG_INFO("Waiting for termination request");
-  mainEventBase_->loopForever();
-  // Manual event loop (alternative to mainEventBase_->loopForever())
-  // while (!stopped_) {
-  // mainEventBase_->loopOnce(EVLOOP_NONBLOCK);
-  // engine_->processEvents();
-  //}
+  if (startupConfig_.runMode != RunMode::Tick) {
+    mainEventBase_->loopForever();
+    return GeneralError::Success;
+  }
+
+  // Each iteration handles due timers and I/O, then runs one bounded tick of
+  // queued calls. The loop blocks only when no calls are left, so a backlog
+  // is worked off without starving timers or the stop sequence.
+  auto pending = false;
+  while (!engineStopped_) {
+    mainEventBase_->loopOnce(pending ? EVLOOP_NONBLOCK : 0);
+    pending = engine_->processEvents();
+  }
 
   return GeneralError::Success;
 }
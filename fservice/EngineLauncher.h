@@ -15,8 +15,12 @@
 
 namespace folly {
 
+class CPUThreadPoolExecutor;
+
 class EventBase;
 
+class IOThreadPoolExecutor;
+
 } // namespace folly
 
 namespace fservice {
@@ -65,15 +69,30 @@ class EngineLauncher final : public IEngineEventHandler {
    */
   std::unique_ptr<SignalHandler> signalHandler_;
 
+  /**
+   * Event loops which handle requests. Null in tick run mode. Must outlive
+   * Engine.
+   */
+  std::unique_ptr<folly::IOThreadPoolExecutor> ioThreadPool_;
+
+  /**
+   * Threads which run request handlers. Null if handlers run in the event
+   * loops. Must outlive Engine.
+   */
+  std::shared_ptr<folly::CPUThreadPoolExecutor> cpuThreadPool_;
+
   std::unique_ptr<Engine> engine_;
 
   folly::EventBase* mainEventBase_ = nullptr;
 
   bool stopped_ = false;
 
-  // std::unique_ptr<ThreadPool> thread_pool_main_;
+  /**
+   * Set once Engine is stopped. Ends the loop of tick mode.
+   */
+  bool engineStopped_ = false;
 
-  // std::unique_ptr<ThreadPool> thread_pool_net_;
+  // std::unique_ptr<ThreadPool> thread_pool_main_;
 };
 
 } // namespace fservice
@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/HelloStreamSession.h>
+
+#include <fservice/IServerEventHandler.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace fservice {
+
+HelloStreamSession::HelloStreamSession(IServerEventHandler* serverEventHandler,
+                                       std::size_t maxPendingReplies)
+    : serverEventHandler_(serverEventHandler),
+      maxPendingReplies_(std::max<std::size_t>(1u, maxPendingReplies)) {
+}
+
+void HelloStreamSession::start() {
+  Actions actions;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    actions = nextActions();
+  }
+  perform(actions);
+}
+
+void HelloStreamSession::onReadDone(bool ok) {
+  Actions actions;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    readInFlight_ = false;
+    if (ok) {
+      dispatch(std::move(request_));
+      request_.Clear();
+    } else {
+      // Client has called WritesDone or the call is dead.
+      readsDone_ = true;
+    }
+    actions = nextActions();
+  }
+  perform(actions);
+}
+
+void HelloStreamSession::onWriteDone(bool ok) {
+  Actions actions;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    writeInFlight_ = false;
+    replies_.pop_front();
+    if (!ok) {
+      LOG_DEBUG("Write failed. Dropping pending replies.");
+      broken_ = true;
+      replies_.clear();
+    }
+    actions = nextActions();
+  }
+  perform(actions);
+}
+
+void HelloStreamSession::synchronize() {
+  std::lock_guard<std::mutex> lock(mutex_);
+}
+
+void HelloStreamSession::dispatch(HelloRequest request) {
+  ++pendingHandlers_;
+  // All requests of the stream go to the same event loop, so replies keep
+  // the order of requests.
+  runInEventLoop([this, request = std::move(request)]() {
+    HelloReply reply;
+    serverEventHandler_->onSayHello(request, reply);
+
+    Actions actions;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --pendingHandlers_;
+      if (!broken_) {
+        replies_.push_back(std::move(reply));
+      }
+      actions = nextActions();
+    }
+    perform(actions);
+  });
+}
+
+HelloStreamSession::Actions HelloStreamSession::nextActions() {
+  Actions actions;
+
+  if (!broken_ && !writeInFlight_ && !replies_.empty()) {
+    writeInFlight_ = true;
+    actions.write = &replies_.front();
+  }
+
+  auto const pendingReplies = pendingHandlers_ + replies_.size();
+  if (!readsDone_ && !broken_ && !readInFlight_ &&
+      pendingReplies < maxPendingReplies_) {
+    readInFlight_ = true;
+    actions.read = true;
+  }
+
+  if (!finishing_ && (readsDone_ || broken_) && !readInFlight_ &&
+      !writeInFlight_ && pendingReplies == 0u) {
+    finishing_ = true;
+    actions.finish = true;
+    actions.status = broken_ ? grpc::Status::CANCELLED : grpc::Status::OK;
+  }
+
+  return actions;
+}
+
+void HelloStreamSession::perform(Actions const& actions) {
+  if (actions.read) {
+    startRead();
+  }
+  if (actions.write != nullptr) {
+    startWrite(*actions.write);
+  }
+  if (actions.finish) {
+    finish(actions.status);
+  }
+}
+
+} // namespace fservice
@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <fservice/Logger.h>
+
+#include <protos/Greeter.pb.h>
+
+#include <folly/Function.h>
+#include <grpcpp/support/status.h>
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+namespace fservice {
+
+struct IServerEventHandler;
+
+/**
+ * Transport independent part of the SayHelloStream call. Each received
+ * request is passed to the handler in the event loop, replies are written
+ * back in order. At most maxPendingReplies requests may be handled or
+ * waiting to be written. When the limit is reached reading is paused, so
+ * the client is throttled by HTTP/2 flow control.
+ *
+ * Derived class provides transport operations and reports their results.
+ * Only one read and one write are in flight at any time. Transport
+ * operations are started outside of the internal lock.
+ */
+class HelloStreamSession {
+ public:
+  HelloStreamSession(HelloStreamSession const&) = delete;
+  HelloStreamSession& operator=(HelloStreamSession const&) = delete;
+
+  virtual ~HelloStreamSession() = default;
+
+ protected:
+  HelloStreamSession(IServerEventHandler* serverEventHandler,
+                     std::size_t maxPendingReplies);
+
+  /**
+   * Start reading requests. Call once the stream is established.
+   */
+  void start();
+
+  /**
+   * Report result of the read started with startRead().
+   */
+  void onReadDone(bool ok);
+
+  /**
+   * Report result of the write started with startWrite().
+   */
+  void onWriteDone(bool ok);
+
+  /**
+   * Wait until no other thread is inside the session. Call before deleting
+   * the session once the stream is finished.
+   */
+  void synchronize();
+
+  /**
+   * Buffer for the request being read.
+   */
+  HelloRequest request_;
+
+ private:
+  DECLARE_GET_LOGGER("Server.HelloStreamSession")
+
+  /**
+   * Read next request into request_.
+   */
+  virtual void startRead() = 0;
+
+  /**
+   * Write reply. Reply stays alive until onWriteDone().
+   */
+  virtual void startWrite(HelloReply const& reply) = 0;
+
+  /**
+   * Finish the stream. Session may be deleted right after this call.
+   */
+  virtual void finish(grpc::Status const& status) = 0;
+
+  /**
+   * Run handler task in the event loop of the stream. Tasks must run in the
+   * order they are passed.
+   */
+  virtual void runInEventLoop(folly::Function<void()> task) = 0;
+
+  /* Transport operations to start. */
+  struct Actions {
+    bool read = false;
+
+    HelloReply const* write = nullptr;
+
+    bool finish = false;
+
+    grpc::Status status;
+  };
+
+  /* Decide which transport operations can be started now. Must be called
+   * under mutex_. */
+  Actions nextActions();
+
+  /* Start decided operations. Must be called without mutex_. Finish goes
+   * last since the session may be deleted right after it. */
+  void perform(Actions const& actions);
+
+  /* Pass request to the handler in the event loop. Must be called under
+   * mutex_. */
+  void dispatch(HelloRequest request);
+
+  IServerEventHandler* const serverEventHandler_;
+
+  std::size_t const maxPendingReplies_;
+
+  std::mutex mutex_;
+
+  /* Replies waiting to be written. Front one is being written if
+   * writeInFlight_ is set. */
+  std::deque<HelloReply> replies_;
+
+  /* Requests passed to the handler and not replied yet. */
+  std::size_t pendingHandlers_ = 0u;
+
+  bool readInFlight_ = false;
+
+  bool writeInFlight_ = false;
+
+  /* Client has finished writing or the read has failed. */
+  bool readsDone_ = false;
+
+  /* Write has failed. Stream is dead, pending replies are dropped. */
+  bool broken_ = false;
+
+  bool finishing_ = false;
+};
+
+} // namespace fservice
@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/HelloWireFormat.h>
+
+#include <protos/Greeter.grpc.pb.h>
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+#include <grpc/slice.h>
+#include <grpcpp/support/proto_buffer_reader.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+namespace fservice {
+
+namespace {
+
+using google::protobuf::internal::WireFormatLite;
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::io::CodedOutputStream;
+
+/* Wire tag of field 1 of length-delimited type. Both HelloRequest::name and
+ * HelloReply::message are such fields. */
+constexpr std::uint32_t kStringFieldTag =
+    WireFormatLite::MakeTag(1, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+
+std::string makeMethodName(std::string const& method) {
+  auto const* service =
+      google::protobuf::DescriptorPool::generated_pool()->FindServiceByName(
+          Greeter::service_full_name());
+  assert(service != nullptr);
+  assert(service->FindMethodByName(method) != nullptr);
+  return "/" + service->full_name() + "/" + method;
+}
+
+} // namespace
+
+std::string const& getSayHelloMethodName() {
+  static auto const name = makeMethodName("SayHello");
+  return name;
+}
+
+std::string const& getSayHelloBatchMethodName() {
+  static auto const name = makeMethodName("SayHelloBatch");
+  return name;
+}
+
+bool readHelloRequestName(grpc::ByteBuffer& request, std::string& name) {
+  grpc::ProtoBufferReader reader(&request);
+  CodedInputStream input(&reader);
+  while (auto const tag = input.ReadTag()) {
+    if (tag == kStringFieldTag) {
+      std::uint32_t size = 0u;
+      if (!input.ReadVarint32(&size) ||
+          !input.ReadString(&name, static_cast<int>(size))) {
+        return false;
+      }
+    } else if (!WireFormatLite::SkipField(&input, tag)) {
+      return false;
+    }
+  }
+  return input.ConsumedEntireMessage();
+}
+
+grpc::ByteBuffer makeHelloReply(std::string_view greeting,
+                                std::string_view name) {
+  // Tag, length and the message itself.
+  auto const messageSize =
+      static_cast<std::uint32_t>(greeting.size() + name.size());
+  auto const headerSize = CodedOutputStream::VarintSize32(kStringFieldTag) +
+                          CodedOutputStream::VarintSize32(messageSize);
+  auto rawSlice = grpc_slice_malloc(headerSize + messageSize);
+  auto* data = GRPC_SLICE_START_PTR(rawSlice);
+  data = CodedOutputStream::WriteVarint32ToArray(kStringFieldTag, data);
+  data = CodedOutputStream::WriteVarint32ToArray(messageSize, data);
+  data = std::copy(greeting.begin(), greeting.end(), data);
+  std::copy(name.begin(), name.end(), data);
+  grpc::Slice slice(rawSlice, grpc::Slice::STEAL_REF);
+  return grpc::ByteBuffer(&slice, 1u);
+}
+
+} // namespace fservice
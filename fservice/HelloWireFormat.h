@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <grpcpp/support/byte_buffer.h>
+
+#include <string>
+#include <string_view>
+
+namespace fservice {
+
+/**
+ * Full name of Greeter::SayHello as gRPC passes it to generic services,
+ * i.e. "/fservice.Greeter/SayHello". Taken from the generated descriptors.
+ */
+std::string const& getSayHelloMethodName();
+
+/** Full name of Greeter::SayHelloBatch, see getSayHelloMethodName. */
+std::string const& getSayHelloBatchMethodName();
+
+/**
+ * Read HelloRequest::name from serialized request without parsing the whole
+ * message. Unknown fields are skipped, repeated name takes the last value
+ * like protobuf parser does.
+ * @param request Serialized HelloRequest.
+ * @param name Filled with the name.
+ * @return false if request is malformed or truncated.
+ */
+bool readHelloRequestName(grpc::ByteBuffer& request, std::string& name);
+
+/**
+ * Serialize HelloReply with message greeting + name straight into a single
+ * slice, without building the message object.
+ */
+grpc::ByteBuffer makeHelloReply(std::string_view greeting,
+                                std::string_view name);
+
+} // namespace fservice
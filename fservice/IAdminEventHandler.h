@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+namespace fservice {
+
+class GetStatsRequest;
+class StatsReply;
+class GetConfigRequest;
+class ConfigReply;
+class ResetStatsRequest;
+class ResetStatsReply;
+
+/**
+ * Receiver of Admin calls. Called in the thread of AdminServer, so it must
+ * not wait for the event loops.
+ */
+struct IAdminEventHandler {
+  virtual ~IAdminEventHandler() = default;
+
+  virtual void onGetStats(GetStatsRequest const& request,
+                          StatsReply& reply) = 0;
+
+  virtual void onGetConfig(GetConfigRequest const& request,
+                           ConfigReply& reply) = 0;
+
+  virtual void onResetStats(ResetStatsRequest const& request,
+                            ResetStatsReply& reply) = 0;
+};
+
+} // namespace fservice
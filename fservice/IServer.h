@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <fservice/ServerStats.h>
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace fservice {
+
+/**
+ * gRPC server backend. Requests are passed to IServerEventHandler.
+ * Server stops on destruction.
+ */
+struct IServer {
+  virtual ~IServer() = default;
+
+  /**
+   * Start listening. Non-blocking.
+   * @param address Address in "host:port" format.
+   */
+  virtual void runAsync(std::string const& address) = 0;
+
+  /**
+   * Add counters of the server to stats. ServerStats is large, so counters
+   * of several servers are summed in place rather than copied. Thread safe.
+   */
+  virtual void addStats(ServerStats& stats) const = 0;
+
+  /**
+   * Get snapshot of counters. Thread safe.
+   */
+  ServerStats getStats() const {
+    ServerStats stats;
+    addStats(stats);
+    return stats;
+  }
+
+  /**
+   * Run calls which wait for the event loops, when the server is configured
+   * with manualDispatch. Must be called in the thread of the event loops.
+   * @param budget Max number of calls to run. Decreased by the number of
+   * calls run.
+   * @param deadline Time to stop taking new batches of calls.
+   * @return True if calls may be left.
+   */
+  virtual bool processEvents(
+      std::size_t& budget, std::chrono::steady_clock::time_point deadline) = 0;
+
+  /**
+   * Stop accepting new calls and wait for the calls in flight. Calls which
+   * are not finished within drainTimeout are cancelled. Blocking.
+   * @param drainTimeout How long calls in flight are allowed to finish.
+   */
+  virtual void shutdown(std::chrono::milliseconds drainTimeout) = 0;
+};
+
+} // namespace fservice
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/IServerEventHandler.h>
+
+#include <fservice/HelloWireFormat.h>
+
+#include <protos/Greeter.pb.h>
+
+#include <google/protobuf/arena.h>
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/support/proto_buffer_reader.h>
+#include <grpcpp/support/proto_buffer_writer.h>
+
+namespace fservice {
+
+namespace {
+
+template <typename Request, typename Reply>
+grpc::Status handleParsed(IServerEventHandler& handler,
+                          void (IServerEventHandler::*handleMethod)(
+                              Request const&, Reply&),
+                          grpc::ByteBuffer& requestBytes,
+                          grpc::ByteBuffer& replyBytes) {
+  google::protobuf::Arena arena;
+  auto* request = google::protobuf::Arena::CreateMessage<Request>(&arena);
+  auto* reply = google::protobuf::Arena::CreateMessage<Reply>(&arena);
+  grpc::ProtoBufferReader reader(&requestBytes);
+  if (!request->ParseFromZeroCopyStream(&reader)) {
+    return grpc::Status(grpc::StatusCode::INTERNAL, "Failed to parse request");
+  }
+  (handler.*handleMethod)(*request, *reply);
+  grpc::ProtoBufferWriter writer(&replyBytes,
+                                 grpc::kProtoBufferWriterMaxBufferLength,
+                                 static_cast<int>(reply->ByteSizeLong()));
+  if (!reply->SerializeToZeroCopyStream(&writer)) {
+    return grpc::Status(grpc::StatusCode::INTERNAL,
+                        "Failed to serialize reply");
+  }
+  return grpc::Status::OK;
+}
+
+} // namespace
+
+void IServerEventHandler::onSayHelloBatch(HelloBatchRequest const& request,
+                                          HelloBatchReply& reply) {
+  reply.mutable_replies()->Reserve(request.requests_size());
+  for (auto const& item : request.requests()) {
+    onSayHello(item, *reply.add_replies());
+  }
+}
+
+folly::SemiFuture<folly::Unit> IServerEventHandler::onSayHelloAsync(
+    HelloRequest const& request, HelloReply& reply) {
+  // Exception of the handler fails the future, so the call gets INTERNAL.
+  return folly::makeSemiFutureWith([&]() { onSayHello(request, reply); });
+}
+
+folly::SemiFuture<folly::Unit> IServerEventHandler::onSayHelloBatchAsync(
+    HelloBatchRequest const& request, HelloBatchReply& reply) {
+  return folly::makeSemiFutureWith([&]() { onSayHelloBatch(request, reply); });
+}
+
+grpc::Status IServerEventHandler::onRawCall(std::string const& method,
+                                            grpc::ByteBuffer& request,
+                                            grpc::ByteBuffer& reply) {
+  if (method == getSayHelloMethodName()) {
+    return handleParsed(
+        *this, &IServerEventHandler::onSayHello, request, reply);
+  }
+  if (method == getSayHelloBatchMethodName()) {
+    return handleParsed(
+        *this, &IServerEventHandler::onSayHelloBatch, request, reply);
+  }
+  return grpc::Status(grpc::StatusCode::UNIMPLEMENTED,
+                      "Method is not served in raw mode: " + method);
+}
+
+} // namespace fservice
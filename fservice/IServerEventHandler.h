@@ -4,15 +4,67 @@
 
 #pragma once
 
+#include <folly/Unit.h>
+#include <folly/futures/Future.h>
+
+#include <string>
+
+namespace grpc {
+
+class ByteBuffer;
+class Status;
+
+} // namespace grpc
+
 namespace fservice {
 
 class HelloRequest;
 class HelloReply;
+class HelloBatchRequest;
+class HelloBatchReply;
 
 struct IServerEventHandler {
   virtual ~IServerEventHandler() = default;
 
   virtual void onSayHello(HelloRequest const& request, HelloReply& reply) = 0;
+
+  /**
+   * Handle the whole batch in one event loop hop. Reply must contain one item
+   * per request, in the same order. Default implementation calls onSayHello
+   * for each request.
+   */
+  virtual void onSayHelloBatch(HelloBatchRequest const& request,
+                               HelloBatchReply& reply);
+
+  /**
+   * Asynchronous variant of onSayHello used by unary calls. Request and reply
+   * are owned by the server and stay valid until the returned future
+   * completes, so the reply may be filled on another executor. The call is
+   * finished with INTERNAL status if the future fails. Default
+   * implementation calls onSayHello in place and fails the future if it
+   * throws.
+   */
+  virtual folly::SemiFuture<folly::Unit> onSayHelloAsync(
+      HelloRequest const& request, HelloReply& reply);
+
+  /**
+   * Asynchronous variant of onSayHelloBatch, see onSayHelloAsync.
+   */
+  virtual folly::SemiFuture<folly::Unit> onSayHelloBatchAsync(
+      HelloBatchRequest const& request, HelloBatchReply& reply);
+
+  /**
+   * Handle unary call in wire format, used when the server runs in raw mode.
+   * Request slices are passed as received, reply slices are sent as is.
+   * Default implementation parses the message and calls the typed handler.
+   * @param method Full method name, e.g. "/fservice.Greeter/SayHello".
+   * @param request Serialized request. May be consumed.
+   * @param reply Serialized reply.
+   * @return Status of the call.
+   */
+  virtual grpc::Status onRawCall(std::string const& method,
+                                 grpc::ByteBuffer& request,
+                                 grpc::ByteBuffer& reply);
 };
 
-} // namespace fservice
\ No newline at end of file
+} // namespace fservice
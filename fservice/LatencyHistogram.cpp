@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/LatencyHistogram.h>
+
+#include <folly/lang/Bits.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace fservice {
+
+std::size_t LatencyHistogram::getBucketIndex(std::uint64_t value) {
+  if (value < kSubBuckets) {
+    return static_cast<std::size_t>(value);
+  }
+  value = std::min(value, (std::uint64_t{1u} << kValueBits) - 1u);
+  // Top kSubBucketBits + 1 bits of the value select the bucket: the leading
+  // one picks the power of two range, the rest the linear bucket in it.
+  auto const shift = folly::findLastSet(value) - 1u - kSubBucketBits;
+  auto const subBucket = (value >> shift) - kSubBuckets;
+  return (shift + 1u) * kSubBuckets + static_cast<std::size_t>(subBucket);
+}
+
+std::uint64_t LatencyHistogram::getBucketUpperBound(std::size_t const index) {
+  assert(index < kBucketsCount);
+  if (index < kSubBuckets) {
+    return index;
+  }
+  auto const shift = index / kSubBuckets - 1u;
+  auto const lowerBound = std::uint64_t{kSubBuckets + index % kSubBuckets}
+                          << shift;
+  return lowerBound + (std::uint64_t{1u} << shift) - 1u;
+}
+
+void LatencyHistogram::record(std::uint64_t const value) {
+  addToBucket(getBucketIndex(value), 1u);
+}
+
+void LatencyHistogram::addToBucket(std::size_t const index,
+                                   std::uint64_t const count) {
+  assert(index < kBucketsCount);
+  buckets_[index] += count;
+  count_ += count;
+}
+
+std::uint64_t LatencyHistogram::getCount() const {
+  return count_;
+}
+
+std::uint64_t LatencyHistogram::getPercentile(double const percentile) const {
+  if (count_ == 0u) {
+    return 0u;
+  }
+  // Rank of the value at percentile, 1-based.
+  auto const rank = std::max<std::uint64_t>(
+      1u,
+      static_cast<std::uint64_t>(
+          std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 *
+                    static_cast<double>(count_))));
+  auto seen = std::uint64_t{0u};
+  for (auto i = 0u; i < kBucketsCount; ++i) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      return getBucketUpperBound(i);
+    }
+  }
+  return getMax();
+}
+
+std::uint64_t LatencyHistogram::getMax() const {
+  for (auto i = kBucketsCount; i > 0u; --i) {
+    if (buckets_[i - 1u] != 0u) {
+      return getBucketUpperBound(i - 1u);
+    }
+  }
+  return 0u;
+}
+
+LatencyHistogram& LatencyHistogram::operator+=(LatencyHistogram const& other) {
+  for (auto i = 0u; i < kBucketsCount; ++i) {
+    buckets_[i] += other.buckets_[i];
+  }
+  count_ += other.count_;
+  return *this;
+}
+
+LatencyHistogram& LatencyHistogram::operator-=(LatencyHistogram const& other) {
+  for (auto i = 0u; i < kBucketsCount; ++i) {
+    assert(buckets_[i] >= other.buckets_[i]);
+    buckets_[i] -= other.buckets_[i];
+  }
+  assert(count_ >= other.count_);
+  count_ -= other.count_;
+  return *this;
+}
+
+} // namespace fservice
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace fservice {
+
+/**
+ * Log-linear histogram of latencies, in microseconds unless stated
+ * otherwise by the owner. Each power of two range
+ * is split into kSubBuckets linear buckets, so quantiles are within
+ * 1/kSubBuckets of the real values over the whole range. Values under
+ * kSubBuckets are exact, values over the range fall into the last bucket.
+ * Not thread safe.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr std::size_t kSubBucketBits = 4u;
+
+  static constexpr std::size_t kSubBuckets = 1u << kSubBucketBits;
+
+  /**
+   * Values up to 2^kValueBits - 1 (about 19 hours of microseconds or 68
+   * seconds of nanoseconds) are counted exactly to their buckets.
+   */
+  static constexpr std::size_t kValueBits = 36u;
+
+  static constexpr std::size_t kBucketsCount =
+      (kValueBits - kSubBucketBits + 1u) * kSubBuckets;
+
+  /**
+   * Bucket which counts value.
+   */
+  static std::size_t getBucketIndex(std::uint64_t value);
+
+  /**
+   * Largest value counted by bucket.
+   */
+  static std::uint64_t getBucketUpperBound(std::size_t index);
+
+  /**
+   * Count one value.
+   */
+  void record(std::uint64_t value);
+
+  /**
+   * Add count values to bucket. Used to merge counters kept elsewhere.
+   */
+  void addToBucket(std::size_t index, std::uint64_t count);
+
+  /**
+   * Number of counted values.
+   */
+  std::uint64_t getCount() const;
+
+  /**
+   * Upper bound of the bucket holding the value at percentile.
+   * @param percentile Percentile in [0, 100].
+   * @return 0 if the histogram is empty.
+   */
+  std::uint64_t getPercentile(double percentile) const;
+
+  /**
+   * Upper bound of the highest non-empty bucket. 0 if the histogram is
+   * empty.
+   */
+  std::uint64_t getMax() const;
+
+  /**
+   * Add values of another histogram.
+   */
+  LatencyHistogram& operator+=(LatencyHistogram const& other);
+
+  /**
+   * Remove values of an earlier snapshot of the same counters, leaving the
+   * values counted since.
+   */
+  LatencyHistogram& operator-=(LatencyHistogram const& other);
+
+ private:
+  std::array<std::uint64_t, kBucketsCount> buckets_{};
+
+  std::uint64_t count_ = 0u;
+};
+
+} // namespace fservice
@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/CounterUtil.h>
+#include <fservice/CycleClock.h>
+#include <fservice/EnumUtil.h>
+#include <fservice/Metrics.h>
+
+#include <atomic>
+#include <cstdint>
+
+namespace fservice {
+
+template <>
+EnumStrings<Rpc>::DataType EnumStrings<Rpc>::data = {
+    "SayHello", "SayHelloBatch", "SayHelloStream", "raw"};
+
+template <>
+EnumStrings<Stage>::DataType EnumStrings<Stage>::data = {
+    "admit", "queue", "handle", "reply", "send", "serialize"};
+
+static_assert(ToIntegral(Stage::Serialize) + 1u == kStagesCount,
+              "Stage count mismatch");
+
+namespace {
+
+using Buckets =
+    std::array<std::atomic<std::uint64_t>, LatencyHistogram::kBucketsCount>;
+
+void record(Buckets& buckets, std::uint64_t const value) {
+  incrementCounter(buckets[LatencyHistogram::getBucketIndex(value)], 1u);
+}
+
+void addBuckets(Buckets const& buckets, LatencyHistogram& histogram) {
+  for (auto i = 0u; i < LatencyHistogram::kBucketsCount; ++i) {
+    if (auto const count = buckets[i].load(std::memory_order_relaxed);
+        count != 0u) {
+      histogram.addToBucket(i, count);
+    }
+  }
+}
+
+} // namespace
+
+/* Counters written by one thread, read by snapshots. */
+struct Metrics::Shard {
+  struct Counters {
+    std::atomic<std::uint64_t> accepted{0u};
+    std::atomic<std::uint64_t> completed{0u};
+    std::atomic<std::uint64_t> failed{0u};
+    Buckets latency{};
+  };
+
+  explicit Shard(Metrics& owner) : owner(owner) {
+  }
+
+  ~Shard() {
+    owner.retire(*this);
+  }
+
+  Shard(Shard const&) = delete;
+  Shard& operator=(Shard const&) = delete;
+
+  void addTo(Snapshot& snapshot) const {
+    for (auto i = 0u; i < kRpcsCount; ++i) {
+      auto const& counters = rpcs[i];
+      auto& rpc = snapshot[i];
+      rpc.accepted += counters.accepted.load(std::memory_order_relaxed);
+      rpc.completed += counters.completed.load(std::memory_order_relaxed);
+      rpc.failed += counters.failed.load(std::memory_order_relaxed);
+      addBuckets(counters.latency, rpc.latency);
+    }
+  }
+
+  void addTo(StagesSnapshot& snapshot) const {
+    for (auto i = 0u; i < kStagesCount; ++i) {
+      addBuckets(stages[i], snapshot[i]);
+    }
+  }
+
+  Metrics& owner;
+
+  std::array<Counters, kRpcsCount> rpcs;
+
+  std::array<Buckets, kStagesCount> stages{};
+};
+
+Metrics::Metrics() : shards_([this]() { return new Shard(*this); }) {
+  // Keep calibration off the first recorded call.
+  CycleClock::calibrate();
+}
+
+Metrics::~Metrics() = default;
+
+void Metrics::onAccepted(Rpc const rpc) {
+  incrementCounter(shards_->rpcs[ToIntegral(rpc)].accepted, 1u);
+}
+
+void Metrics::onFinished(Rpc const rpc,
+                         bool const ok,
+                         std::chrono::nanoseconds const latency) {
+  auto& counters = shards_->rpcs[ToIntegral(rpc)];
+  incrementCounter(ok ? counters.completed : counters.failed, 1u);
+  auto const latencyUs =
+      std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+  record(counters.latency,
+         static_cast<std::uint64_t>(latencyUs > 0 ? latencyUs : 0));
+}
+
+void Metrics::onStage(Stage const stage, std::uint64_t const ticks) {
+  record(shards_->stages[ToIntegral(stage)], CycleClock::toNanoseconds(ticks));
+}
+
+Metrics::Snapshot Metrics::getSnapshot() const {
+  Snapshot snapshot;
+  addSnapshot(snapshot);
+  return snapshot;
+}
+
+void Metrics::addSnapshot(Snapshot& snapshot) const {
+  // Threads can't exit while their shards are accessed.
+  auto accessor = shards_.accessAllThreads();
+  for (auto const& shard : accessor) {
+    shard.addTo(snapshot);
+  }
+  std::lock_guard<std::mutex> const lock(retiredMutex_);
+  for (auto i = 0u; i < kRpcsCount; ++i) {
+    snapshot[i] += retired_[i];
+  }
+}
+
+Metrics::StagesSnapshot Metrics::getStagesSnapshot() const {
+  StagesSnapshot snapshot;
+  addStagesSnapshot(snapshot);
+  return snapshot;
+}
+
+void Metrics::addStagesSnapshot(StagesSnapshot& snapshot) const {
+  auto accessor = shards_.accessAllThreads();
+  for (auto const& shard : accessor) {
+    shard.addTo(snapshot);
+  }
+  std::lock_guard<std::mutex> const lock(retiredMutex_);
+  for (auto i = 0u; i < kStagesCount; ++i) {
+    snapshot[i] += retiredStages_[i];
+  }
+}
+
+void Metrics::retire(Shard const& shard) {
+  std::lock_guard<std::mutex> const lock(retiredMutex_);
+  shard.addTo(retired_);
+  shard.addTo(retiredStages_);
+}
+
+} // namespace fservice
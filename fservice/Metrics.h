@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <fservice/ServerStats.h>
+
+#include <folly/ThreadLocal.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace fservice {
+
+/**
+ * Method of the Greeter service. Calls of raw mode are counted as Raw.
+ */
+enum class Rpc { SayHello, SayHelloBatch, SayHelloStream, Raw };
+
+/**
+ * Stage of a unary call. Admit to Send follow one another from taking the
+ * call from the completion queue to taking its Finish tag:
+ * - Admit: shedding, cache lookup and coalescing in the queue thread;
+ * - Queue: wait in the dispatch lanes of the event loop;
+ * - Handle: the handler, its executor hop included;
+ * - Reply: from the handler end to Finish, replies of coalesced calls and
+ *   cache insert included;
+ * - Send: from Finish to its tag, i.e. sending and completion queue polling.
+ * Serialize is the first part of Send, the Finish call itself, which
+ * serializes the reply in the calling thread. It is not counted in Send, so
+ * the stages add up to the whole call.
+ */
+enum class Stage { Admit, Queue, Handle, Reply, Send, Serialize };
+
+/**
+ * Counters and latency histograms of calls by Rpc and of unary call stages
+ * by Stage. Each thread records into
+ * its own shard, so recording takes no locks and shares no cache lines with
+ * other threads. Snapshots sum the shards, counters of exited threads
+ * included. Thread safe.
+ */
+class Metrics {
+ public:
+  using Snapshot = std::array<RpcMetrics, kRpcsCount>;
+
+  /**
+   * Stage latencies in nanoseconds, indexed by Stage.
+   */
+  using StagesSnapshot = std::array<LatencyHistogram, kStagesCount>;
+
+  Metrics();
+
+  ~Metrics();
+
+  Metrics(Metrics const&) = delete;
+  Metrics& operator=(Metrics const&) = delete;
+
+  /**
+   * Count received call.
+   */
+  void onAccepted(Rpc rpc);
+
+  /**
+   * Count finished call.
+   * @param ok Call is finished with OK status and its reply is sent.
+   * @param latency Time since the call was received.
+   */
+  void onFinished(Rpc rpc, bool ok, std::chrono::nanoseconds latency);
+
+  /**
+   * Count time spent in stage.
+   * @param ticks Duration in CycleClock ticks.
+   */
+  void onStage(Stage stage, std::uint64_t ticks);
+
+  /**
+   * Counters since creation.
+   */
+  Snapshot getSnapshot() const;
+
+  /**
+   * Add counters since creation to snapshot, which saves a copy when
+   * counters of several servers are summed.
+   */
+  void addSnapshot(Snapshot& snapshot) const;
+
+  /**
+   * Stage latencies since creation.
+   */
+  StagesSnapshot getStagesSnapshot() const;
+
+  /**
+   * Add stage latencies since creation to snapshot.
+   */
+  void addStagesSnapshot(StagesSnapshot& snapshot) const;
+
+ private:
+  struct Shard;
+
+  struct ShardTag;
+
+  /* Add counters of a thread which is exiting to retired_. */
+  void retire(Shard const& shard);
+
+  /* Guards retired_. Taken while shards are accessed, so an exiting thread
+   * is counted either in its shard or in retired_. */
+  mutable std::mutex retiredMutex_;
+
+  Snapshot retired_;
+
+  StagesSnapshot retiredStages_;
+
+  /* Declared last: shards of live threads retire on destruction. */
+  folly::ThreadLocal<Shard, ShardTag, folly::AccessModeStrict> shards_;
+};
+
+} // namespace fservice
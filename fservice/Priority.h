@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace fservice {
+
+/**
+ * Priority of a call. Taken from "x-priority" client metadata: "high",
+ * "normal" or "low". Calls of each priority have own dispatch lane.
+ */
+enum class Priority { High, Normal, Low };
+
+/**
+ * Number of dispatch lanes, one per Priority.
+ */
+constexpr std::size_t kPrioritiesCount = 3u;
+
+/**
+ * Tasks taken from each dispatch lane per round, indexed by Priority.
+ */
+using LaneWeights = std::array<std::uint32_t, kPrioritiesCount>;
+
+} // namespace fservice
@@ -0,0 +1,176 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/PrometheusFormat.h>
+
+#include <protos/Admin.pb.h>
+
+#include <fmt/format.h>
+
+#include <cstdint>
+#include <utility>
+
+namespace fservice {
+
+namespace {
+
+void appendHeader(std::string& out,
+                  char const* name,
+                  char const* type,
+                  char const* help) {
+  out += fmt::format("# HELP {} {}\n# TYPE {} {}\n", name, help, name, type);
+}
+
+/* Metric with one label per method. */
+template <typename Getter>
+void appendRpcMetric(std::string& out,
+                     StatsReply const& stats,
+                     char const* name,
+                     char const* type,
+                     char const* help,
+                     Getter getter) {
+  appendHeader(out, name, type, help);
+  for (auto const& rpc : stats.rpcs()) {
+    out += fmt::format(
+        "{}{{method=\"{}\"}} {}\n", name, rpc.method(), getter(rpc));
+  }
+}
+
+/* Metric with one label per dispatch lane. */
+template <typename Getter>
+void appendLaneMetric(std::string& out,
+                      StatsReply const& stats,
+                      char const* name,
+                      char const* type,
+                      char const* help,
+                      Getter getter) {
+  appendHeader(out, name, type, help);
+  for (auto const& lane : stats.lanes()) {
+    out += fmt::format(
+        "{}{{priority=\"{}\"}} {}\n", name, lane.priority(), getter(lane));
+  }
+}
+
+void appendMetric(std::string& out,
+                  char const* name,
+                  char const* type,
+                  char const* help,
+                  std::uint64_t value) {
+  appendHeader(out, name, type, help);
+  out += fmt::format("{} {}\n", name, value);
+}
+
+} // namespace
+
+std::string formatPrometheus(StatsReply const& stats) {
+  using Lane = DispatchLaneStats;
+  std::string out;
+  appendRpcMetric(out,
+                  stats,
+                  "fservice_calls_accepted_total",
+                  "counter",
+                  "Calls received.",
+                  [](RpcStats const& rpc) { return rpc.accepted(); });
+  appendRpcMetric(out,
+                  stats,
+                  "fservice_calls_completed_total",
+                  "counter",
+                  "Calls finished with OK status.",
+                  [](RpcStats const& rpc) { return rpc.completed(); });
+  appendRpcMetric(out,
+                  stats,
+                  "fservice_calls_failed_total",
+                  "counter",
+                  "Calls finished with error status.",
+                  [](RpcStats const& rpc) { return rpc.failed(); });
+  appendRpcMetric(out,
+                  stats,
+                  "fservice_calls_in_flight",
+                  "gauge",
+                  "Calls received and not finished yet.",
+                  [](RpcStats const& rpc) { return rpc.in_flight(); });
+
+  // Histogram keeps no sum of latencies, so quantiles are gauges rather
+  // than a summary.
+  auto const* latencyName = "fservice_call_latency_microseconds";
+  appendHeader(out,
+               latencyName,
+               "gauge",
+               "Quantiles of time from receiving a call to its end.");
+  for (auto const& rpc : stats.rpcs()) {
+    auto const& latency = rpc.latency();
+    std::pair<char const*, std::uint64_t> const quantiles[] = {
+        {"0.5", latency.p50_us()},
+        {"0.9", latency.p90_us()},
+        {"0.99", latency.p99_us()},
+        {"0.999", latency.p999_us()}};
+    for (auto const& [quantile, value] : quantiles) {
+      out += fmt::format("{}{{method=\"{}\",quantile=\"{}\"}} {}\n",
+                         latencyName,
+                         rpc.method(),
+                         quantile,
+                         value);
+    }
+  }
+  appendRpcMetric(out,
+                  stats,
+                  "fservice_call_latency_max_microseconds",
+                  "gauge",
+                  "Longest call.",
+                  [](RpcStats const& rpc) { return rpc.latency().max_us(); });
+
+  appendMetric(out,
+               "fservice_calls_shed_total",
+               "counter",
+               "Calls rejected due to in-flight limits.",
+               stats.shed_calls());
+  appendMetric(out,
+               "fservice_calls_aborted_total",
+               "counter",
+               "Calls dropped because they were cancelled or expired.",
+               stats.aborted_calls());
+  appendMetric(out,
+               "fservice_cache_hits_total",
+               "counter",
+               "Calls served from the response cache.",
+               stats.cache_hits());
+  appendMetric(out,
+               "fservice_cache_misses_total",
+               "counter",
+               "Calls not found in the response cache.",
+               stats.cache_misses());
+  appendMetric(out,
+               "fservice_calls_coalesced_total",
+               "counter",
+               "Calls finished with the reply of an identical call.",
+               stats.coalesced_calls());
+
+  appendLaneMetric(out,
+                   stats,
+                   "fservice_lane_depth",
+                   "gauge",
+                   "Calls waiting in the dispatch lane.",
+                   [](Lane const& lane) { return lane.depth(); });
+  appendLaneMetric(out,
+                   stats,
+                   "fservice_lane_dispatched_total",
+                   "counter",
+                   "Calls taken from the dispatch lane.",
+                   [](Lane const& lane) { return lane.dispatched(); });
+  appendLaneMetric(out,
+                   stats,
+                   "fservice_lane_overflowed_total",
+                   "counter",
+                   "Calls which found the dispatch lane full.",
+                   [](Lane const& lane) { return lane.overflowed(); });
+  appendLaneMetric(out,
+                   stats,
+                   "fservice_lane_max_wait_microseconds",
+                   "gauge",
+                   "Longest wait of a call in the dispatch lane.",
+                   [](Lane const& lane) { return lane.max_wait_us(); });
+  return out;
+}
+
+} // namespace fservice
@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <string>
+
+namespace fservice {
+
+class StatsReply;
+
+/**
+ * Render stats in Prometheus text exposition format. Call latencies are
+ * gauges labeled with 0.5, 0.9, 0.99 and 0.999 quantiles.
+ */
+std::string formatPrometheus(StatsReply const& stats);
+
+} // namespace fservice
@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/CounterUtil.h>
+#include <fservice/QueuePoller.h>
+
+#include <grpcpp/grpcpp.h>
+
+#include <pthread.h>
+
+namespace fservice {
+
+QueuePoller::QueuePoller(grpc::CompletionQueue* completionQueue,
+                         std::chrono::microseconds const spinTime,
+                         bool const park)
+    : completionQueue_(completionQueue), spinTime_(spinTime), park_(park) {
+}
+
+namespace {
+
+std::uint64_t readCpuTimeUs(clockid_t const cpuClock) {
+  timespec cpuTime{};
+  if (clock_gettime(cpuClock, &cpuTime) != 0) {
+    return 0u;
+  }
+  return static_cast<std::uint64_t>(cpuTime.tv_sec) * 1000000u +
+         static_cast<std::uint64_t>(cpuTime.tv_nsec) / 1000u;
+}
+
+} // namespace
+
+void QueuePoller::bindCurrentThread() {
+  std::lock_guard<std::mutex> const lock(cpuClockMutex_);
+  cpuClockBound_ = pthread_getcpuclockid(pthread_self(), &cpuClock_) == 0;
+}
+
+void QueuePoller::unbindCurrentThread() {
+  std::lock_guard<std::mutex> const lock(cpuClockMutex_);
+  if (cpuClockBound_) {
+    cpuTimeUs_ = readCpuTimeUs(cpuClock_);
+    cpuClockBound_ = false;
+  }
+}
+
+bool QueuePoller::next(void** tag, bool* ok) {
+  if (spinTime_.count() <= 0) {
+    return completionQueue_->Next(tag, ok);
+  }
+  auto shutdown = false;
+  if (spin(tag, ok, shutdown)) {
+    return true;
+  }
+  if (shutdown) {
+    return false;
+  }
+  incrementCounter(parks_, 1u);
+  return completionQueue_->Next(tag, ok);
+}
+
+bool QueuePoller::spin(void** tag, bool* ok, bool& shutdown) {
+  auto const startedAt = Clock::now();
+  auto const deadline = gpr_time_0(GPR_CLOCK_MONOTONIC);
+  auto now = startedAt;
+  auto gotEvent = false;
+  do {
+    auto const status = completionQueue_->AsyncNext(tag, ok, deadline);
+    if (status == grpc::CompletionQueue::GOT_EVENT) {
+      gotEvent = true;
+    } else if (status == grpc::CompletionQueue::SHUTDOWN) {
+      shutdown = true;
+    }
+    now = Clock::now();
+  } while (!gotEvent && !shutdown &&
+           (!park_ || now - startedAt < spinTime_));
+  incrementCounter(spinTimeUs_,
+                   static_cast<std::uint64_t>(
+                       std::chrono::duration_cast<std::chrono::microseconds>(
+                           now - startedAt)
+                           .count()));
+  if (gotEvent) {
+    incrementCounter(spinHits_, 1u);
+  }
+  return gotEvent;
+}
+
+std::uint64_t QueuePoller::getSpinHits() const {
+  return spinHits_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t QueuePoller::getParks() const {
+  return parks_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t QueuePoller::getSpinTimeUs() const {
+  return spinTimeUs_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t QueuePoller::getCpuTimeUs() const {
+  std::lock_guard<std::mutex> const lock(cpuClockMutex_);
+  return cpuClockBound_ ? readCpuTimeUs(cpuClock_) : cpuTimeUs_;
+}
+
+} // namespace fservice
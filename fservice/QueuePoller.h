@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+
+namespace grpc {
+
+class CompletionQueue;
+
+} // namespace grpc
+
+namespace fservice {
+
+/**
+ * Takes events from a completion queue for its polling thread. By default
+ * blocks in Next. In busy-poll mode spins on AsyncNext with zero deadline
+ * after each event, so the next event is picked up without a thread wakeup,
+ * and parks in Next once nothing has come for the spin time. Counters are
+ * thread safe, polling is done by one thread.
+ */
+class QueuePoller {
+ public:
+  /**
+   * Create poller.
+   * @param completionQueue Queue to poll.
+   * @param spinTime How long to spin without events before parking. 0
+   * disables busy polling.
+   * @param park Park after the spin time. If false the thread never blocks.
+   */
+  QueuePoller(grpc::CompletionQueue* completionQueue,
+              std::chrono::microseconds spinTime,
+              bool park);
+
+  QueuePoller(QueuePoller const&) = delete;
+  QueuePoller& operator=(QueuePoller const&) = delete;
+
+  /**
+   * Remember the calling thread as the polling one, so its CPU time can be
+   * reported.
+   */
+  void bindCurrentThread();
+
+  /**
+   * Keep the CPU time of the polling thread, which is about to exit. Called
+   * by the bound thread, so its clock is never read after it has exited and
+   * its thread id may belong to another thread.
+   */
+  void unbindCurrentThread();
+
+  /**
+   * Get next event of the queue.
+   * @return False if the queue is shut down and drained.
+   */
+  bool next(void** tag, bool* ok);
+
+  /**
+   * Events picked up while spinning.
+   */
+  std::uint64_t getSpinHits() const;
+
+  /**
+   * Times the thread blocked waiting for events. Each costs a wakeup.
+   */
+  std::uint64_t getParks() const;
+
+  /**
+   * Time spent spinning, microseconds.
+   */
+  std::uint64_t getSpinTimeUs() const;
+
+  /**
+   * CPU time used by the polling thread, microseconds. Final value once the
+   * thread is unbound, 0 if it has never been bound.
+   */
+  std::uint64_t getCpuTimeUs() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  /* Spin until an event comes or the spin time passes. */
+  bool spin(void** tag, bool* ok, bool& shutdown);
+
+  grpc::CompletionQueue* const completionQueue_;
+
+  std::chrono::microseconds const spinTime_;
+
+  bool const park_;
+
+  std::atomic<std::uint64_t> spinHits_{0u};
+
+  std::atomic<std::uint64_t> parks_{0u};
+
+  std::atomic<std::uint64_t> spinTimeUs_{0u};
+
+  /* Guards the fields below. Held while the clock is read, so the thread
+   * can't unbind and exit meanwhile. */
+  mutable std::mutex cpuClockMutex_;
+
+  /* CPU clock of the polling thread, valid while cpuClockBound_ is set. */
+  clockid_t cpuClock_{};
+
+  bool cpuClockBound_ = false;
+
+  /* CPU time of the thread when it was unbound. */
+  std::uint64_t cpuTimeUs_ = 0u;
+};
+
+} // namespace fservice
@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fservice {
+
+/**
+ * Tracks identical requests in flight, so the handler runs once per group.
+ * The first call of a key becomes the leader and runs the handler. Calls
+ * which join while the leader runs become followers and get the leader's
+ * reply. Thread safe.
+ */
+template <typename Call>
+class RequestCoalescer {
+ public:
+  RequestCoalescer() = default;
+
+  RequestCoalescer(RequestCoalescer const&) = delete;
+  RequestCoalescer& operator=(RequestCoalescer const&) = delete;
+
+  /**
+   * Register call with the given request key.
+   * @return True if the call is the leader and must run the handler. False
+   * if the call waits for the leader.
+   */
+  bool join(std::string const& key, Call* call);
+
+  /**
+   * Let the leader give up without running the handler.
+   * @return True if there are no followers and the key is released. False if
+   * followers wait, so the leader must run the handler.
+   */
+  bool tryAbandon(std::string const& key);
+
+  /**
+   * Release the key once the leader's reply is ready.
+   * @return Followers which must be finished with the leader's reply.
+   */
+  std::vector<Call*> complete(std::string const& key);
+
+  /**
+   * Number of calls which got the reply of another call.
+   */
+  std::uint64_t getCoalesced() const;
+
+ private:
+  std::mutex mutex_;
+
+  /* Followers by key of the leader's request. */
+  std::unordered_map<std::string, std::vector<Call*>> inFlight_;
+
+  std::atomic<std::uint64_t> coalesced_{0u};
+};
+
+template <typename Call>
+bool RequestCoalescer<Call>::join(std::string const& key, Call* call) {
+  std::lock_guard<std::mutex> const lock(mutex_);
+  auto const [it, inserted] = inFlight_.try_emplace(key);
+  if (!inserted) {
+    it->second.push_back(call);
+    coalesced_.fetch_add(1u, std::memory_order_relaxed);
+  }
+  return inserted;
+}
+
+template <typename Call>
+bool RequestCoalescer<Call>::tryAbandon(std::string const& key) {
+  std::lock_guard<std::mutex> const lock(mutex_);
+  auto const it = inFlight_.find(key);
+  if (it != inFlight_.end() && !it->second.empty()) {
+    return false;
+  }
+  if (it != inFlight_.end()) {
+    inFlight_.erase(it);
+  }
+  return true;
+}
+
+template <typename Call>
+std::vector<Call*> RequestCoalescer<Call>::complete(std::string const& key) {
+  std::vector<Call*> followers;
+  std::lock_guard<std::mutex> const lock(mutex_);
+  auto const it = inFlight_.find(key);
+  if (it != inFlight_.end()) {
+    followers = std::move(it->second);
+    inFlight_.erase(it);
+  }
+  return followers;
+}
+
+template <typename Call>
+std::uint64_t RequestCoalescer<Call>::getCoalesced() const {
+  return coalesced_.load(std::memory_order_relaxed);
+}
+
+} // namespace fservice
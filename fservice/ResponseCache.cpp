@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/ResponseCache.h>
+
+#include <folly/hash/Hash.h>
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace fservice {
+
+ResponseCache::Shard::Shard(std::size_t capacity) : entries(capacity) {
+  entries.setPruneHook([this](std::string const&, Entry&&) {
+    evictions.fetch_add(1u, std::memory_order_relaxed);
+  });
+}
+
+ResponseCache::ResponseCache(std::size_t capacity,
+                             std::chrono::milliseconds ttl,
+                             std::size_t shardsCount)
+    : ttl_(ttl) {
+  assert(capacity > 0u);
+  // Every shard holds at least one entry, so small caches get fewer shards.
+  // First shards take the remainder, shards together hold exactly capacity.
+  shardsCount = std::clamp<std::size_t>(shardsCount, 1u, capacity);
+  shards_.reserve(shardsCount);
+  for (auto i = 0u; i < shardsCount; ++i) {
+    auto const shardCapacity =
+        capacity / shardsCount + (i < capacity % shardsCount ? 1u : 0u);
+    shards_.push_back(std::make_unique<Shard>(shardCapacity));
+  }
+}
+
+ResponseCache::Value ResponseCache::find(std::string const& key) {
+  auto& shard = getShard(key);
+  {
+    std::lock_guard<std::mutex> const lock(shard.mutex);
+    auto const it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+      if (ttl_.count() == 0 || Clock::now() < it->second.expiresAt) {
+        shard.hits.fetch_add(1u, std::memory_order_relaxed);
+        return it->second.value;
+      }
+      shard.entries.erase(key);
+    }
+  }
+  shard.misses.fetch_add(1u, std::memory_order_relaxed);
+  return nullptr;
+}
+
+void ResponseCache::insert(std::string const& key, std::string value) {
+  // Allocate outside the lock.
+  auto entry = Entry{std::make_shared<std::string const>(std::move(value)),
+                     Clock::now() + ttl_};
+  auto& shard = getShard(key);
+  std::lock_guard<std::mutex> const lock(shard.mutex);
+  shard.entries.set(key, std::move(entry));
+}
+
+std::uint64_t ResponseCache::getHits() const {
+  std::uint64_t hits = 0u;
+  for (auto const& shard : shards_) {
+    hits += shard->hits.load(std::memory_order_relaxed);
+  }
+  return hits;
+}
+
+std::uint64_t ResponseCache::getMisses() const {
+  std::uint64_t misses = 0u;
+  for (auto const& shard : shards_) {
+    misses += shard->misses.load(std::memory_order_relaxed);
+  }
+  return misses;
+}
+
+std::uint64_t ResponseCache::getEvictions() const {
+  std::uint64_t evictions = 0u;
+  for (auto const& shard : shards_) {
+    evictions += shard->evictions.load(std::memory_order_relaxed);
+  }
+  return evictions;
+}
+
+ResponseCache::Shard& ResponseCache::getShard(std::string const& key) {
+  assert(!shards_.empty());
+  // Remix the hash, so keys of one shard still spread over all buckets of
+  // its map.
+  auto const hash = folly::hash::twang_mix64(folly::hasher<std::string>{}(key));
+  return *shards_[hash % shards_.size()];
+}
+
+} // namespace fservice
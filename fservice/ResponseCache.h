@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <folly/container/EvictingCacheMap.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fservice {
+
+/**
+ * LRU cache of serialized replies keyed by serialized requests. Split into
+ * shards with own locks, so threads rarely contend. Thread safe.
+ */
+class ResponseCache {
+ public:
+  using Value = std::shared_ptr<std::string const>;
+
+  /**
+   * Create cache.
+   * @param capacity Max number of entries of all shards. Must be positive.
+   * @param ttl How long entry is valid after insertion. 0 means forever.
+   * @param shardsCount Number of shards. Capped by capacity.
+   */
+  ResponseCache(std::size_t capacity,
+                std::chrono::milliseconds ttl,
+                std::size_t shardsCount);
+
+  ResponseCache(ResponseCache const&) = delete;
+  ResponseCache& operator=(ResponseCache const&) = delete;
+
+  /**
+   * Find reply and mark it as recently used. Counts hits and misses.
+   * @return Reply or nullptr if it is missing or expired.
+   */
+  Value find(std::string const& key);
+
+  /**
+   * Insert or replace reply. Least recently used entry of the shard is
+   * evicted if the shard is full.
+   */
+  void insert(std::string const& key, std::string value);
+
+  std::uint64_t getHits() const;
+
+  std::uint64_t getMisses() const;
+
+  /**
+   * Number of entries evicted to make room for new ones.
+   */
+  std::uint64_t getEvictions() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Entry {
+    Value value;
+    Clock::time_point expiresAt;
+  };
+
+  struct Shard {
+    explicit Shard(std::size_t capacity);
+
+    std::mutex mutex;
+
+    folly::EvictingCacheMap<std::string, Entry> entries;
+
+    std::atomic<std::uint64_t> hits{0u};
+
+    std::atomic<std::uint64_t> misses{0u};
+
+    std::atomic<std::uint64_t> evictions{0u};
+  };
+
+  Shard& getShard(std::string const& key);
+
+  std::chrono::milliseconds const ttl_;
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace fservice
@@ -0,0 +1,14 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/EnumUtil.h>
+#include <fservice/ServerConfig.h>
+
+namespace fservice {
+
+template <>
+EnumStrings<ServerBackend>::DataType EnumStrings<ServerBackend>::data = {
+    "cq", "callback"};
+
+} // namespace fservice
@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <fservice/Priority.h>
+#include <fservice/ThreadPlacement.h>
+#include <fservice/TransportConfig.h>
+
+#include <chrono>
+#include <cstdint>
+
+namespace fservice {
+
+/**
+ * Implementation of the gRPC server.
+ */
+enum class ServerBackend {
+  /** Completion queues polled by own threads (AsyncServer). */
+  CompletionQueue,
+  /** gRPC callback API (CallbackServer). */
+  Callback
+};
+
+/**
+ * Tuning parameters of the gRPC server.
+ */
+struct ServerConfig {
+  /**
+   * Server implementation.
+   */
+  ServerBackend backend = ServerBackend::CompletionQueue;
+
+  /**
+   * Number of independent servers listening on the same address with
+   * SO_REUSEPORT. Kernel balances connections across them. Queues and event
+   * loops are split between the servers.
+   */
+  std::uint32_t listenersCount = 1u;
+
+  /**
+   * Number of completion queues. Each queue is polled by its own thread and
+   * has its own set of pre-posted calls.
+   */
+  std::uint32_t queuesCount = 1u;
+
+  /**
+   * Accept backlog. Number of SayHello calls kept armed on each completion
+   * queue, so bursts of new calls don't wait for the queue thread to re-arm.
+   */
+  std::uint32_t prepostCount = 1u;
+
+  /**
+   * Max number of SayHelloStream requests per stream which are being handled
+   * or wait for their replies to be written. Reading from the stream pauses
+   * when the limit is reached.
+   */
+  std::uint32_t streamMaxPendingReplies = 16u;
+
+  /**
+   * Max number of unary calls in flight in the whole server. Calls over the
+   * limit fail with RESOURCE_EXHAUSTED. 0 means no limit.
+   */
+  std::uint32_t maxInFlight = 0u;
+
+  /**
+   * Max number of unary calls in flight taken from one completion queue.
+   * 0 means no limit. Not used by the callback backend.
+   */
+  std::uint32_t maxInFlightPerQueue = 0u;
+
+  /**
+   * How long calls in flight are allowed to finish on shutdown. The rest are
+   * cancelled.
+   */
+  std::chrono::milliseconds drainTimeout{5000};
+
+  /**
+   * Max number of SayHello replies kept in the response cache. 0 disables
+   * the cache. Completion queue backend only.
+   */
+  std::uint32_t cacheCapacity = 0u;
+
+  /**
+   * How long cached reply stays valid. 0 means forever.
+   */
+  std::chrono::milliseconds cacheTtl{0};
+
+  /**
+   * Run the handler once for identical SayHello calls in flight and send its
+   * reply to all of them. Completion queue backend only.
+   */
+  bool coalesceRequests = false;
+
+  /**
+   * Unary calls taken per round from the high, normal and low priority lanes
+   * of an event loop. Priority is set by "x-priority" client metadata.
+   * Completion queue backend only.
+   */
+  LaneWeights laneWeights{8u, 2u, 1u};
+
+  /**
+   * Capacity of the ring of each lane. Calls which find the ring full wait
+   * in a locked list of the lane.
+   */
+  std::uint32_t laneCapacity = 4096u;
+
+  /**
+   * Serve unary calls in wire format through IServerEventHandler::onRawCall,
+   * skipping protobuf parsing and serialization in the server. Streams are
+   * not served in this mode. Completion queue backend only.
+   */
+  bool rawMode = false;
+
+  /**
+   * Busy-poll completion queues: after each event the queue thread spins
+   * for this time waiting for the next one instead of blocking, trading CPU
+   * for wakeup latency. 0 disables busy polling. Completion queue backend
+   * only.
+   */
+  std::chrono::microseconds busyPollSpin{0};
+
+  /**
+   * Block the queue thread once nothing has come for busyPollSpin. If false
+   * the thread spins all the time and needs a dedicated core.
+   */
+  bool busyPollPark = true;
+
+  /**
+   * Dispatched unary calls, stream requests and continuations of async
+   * handlers are run by IServer::processEvents only, not by the event loops
+   * on their own. 'cq' backend only.
+   */
+  bool manualDispatch = false;
+
+  /**
+   * HTTP/2 and resource options.
+   */
+  TransportConfig transport;
+
+  /**
+   * Cores of the server and engine threads.
+   */
+  ThreadPlacement placement;
+};
+
+} // namespace fservice
@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <fservice/LatencyHistogram.h>
+#include <fservice/Priority.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace fservice {
+
+/**
+ * Number of buckets of dispatch batch sizes: 1, 2-3, 4-7, ..., 64 and more.
+ */
+constexpr std::size_t kBatchSizeBuckets = 7u;
+
+/**
+ * Number of methods with their own call metrics, one per Rpc.
+ */
+constexpr std::size_t kRpcsCount = 4u;
+
+/**
+ * Number of measured stages of unary calls, one per Stage.
+ */
+constexpr std::size_t kStagesCount = 6u;
+
+/**
+ * Counters of calls of one method.
+ */
+struct RpcMetrics {
+  /**
+   * Calls received.
+   */
+  std::uint64_t accepted = 0u;
+
+  /**
+   * Calls finished with OK status.
+   */
+  std::uint64_t completed = 0u;
+
+  /**
+   * Calls finished with error status, shed and aborted ones included, or
+   * whose reply could not be sent.
+   */
+  std::uint64_t failed = 0u;
+
+  /**
+   * Time from receiving a call to its end, microseconds. Streams are
+   * counted once, for their whole life.
+   */
+  LatencyHistogram latency;
+
+  /**
+   * Calls received and not finished yet. Counters of a snapshot are read one
+   * by one, so it may count a call finished but not received yet.
+   */
+  std::uint64_t getInFlight() const {
+    auto const finished = completed + failed;
+    return accepted > finished ? accepted - finished : 0u;
+  }
+
+  RpcMetrics& operator+=(RpcMetrics const& other) {
+    accepted += other.accepted;
+    completed += other.completed;
+    failed += other.failed;
+    latency += other.latency;
+    return *this;
+  }
+
+  /**
+   * Remove counters of an earlier snapshot, leaving the calls since.
+   */
+  RpcMetrics& operator-=(RpcMetrics const& other) {
+    accepted -= other.accepted;
+    completed -= other.completed;
+    failed -= other.failed;
+    latency -= other.latency;
+    return *this;
+  }
+};
+
+/**
+ * Counters of one dispatch lane.
+ */
+struct LaneStats {
+  /**
+   * Calls waiting in the lane.
+   */
+  std::uint64_t depth = 0u;
+
+  /**
+   * Calls which found the ring of the lane full and went to its overflow
+   * list.
+   */
+  std::uint64_t overflowed = 0u;
+
+  /**
+   * Calls taken from the lane for handling.
+   */
+  std::uint64_t dispatched = 0u;
+
+  /**
+   * Sum of time dispatched calls waited to start, microseconds.
+   */
+  std::uint64_t waitTimeUs = 0u;
+
+  /**
+   * Longest time a call waited to start, microseconds.
+   */
+  std::uint64_t maxWaitTimeUs = 0u;
+
+  LaneStats& operator+=(LaneStats const& other) {
+    depth += other.depth;
+    overflowed += other.overflowed;
+    dispatched += other.dispatched;
+    waitTimeUs += other.waitTimeUs;
+    maxWaitTimeUs = maxWaitTimeUs > other.maxWaitTimeUs ? maxWaitTimeUs
+                                                        : other.maxWaitTimeUs;
+    return *this;
+  }
+};
+
+/**
+ * Snapshot of the gRPC server counters.
+ */
+struct ServerStats {
+  /**
+   * Number of CallData slots allocated in all pools.
+   */
+  std::uint64_t callDataSlots = 0u;
+
+  /**
+   * How many times a pool had no free slot and had to grow.
+   */
+  std::uint64_t callDataPoolExhausted = 0u;
+
+  /**
+   * Unary calls admitted for handling.
+   */
+  std::uint64_t acceptedCalls = 0u;
+
+  /**
+   * Unary calls rejected with RESOURCE_EXHAUSTED due to in-flight limits.
+   */
+  std::uint64_t shedCalls = 0u;
+
+  /**
+   * Unary calls admitted and not finished yet.
+   */
+  std::uint64_t inFlightCalls = 0u;
+
+  /**
+   * Unary calls finished without handling or without their reply because
+   * the client had cancelled them or their deadline had passed.
+   */
+  std::uint64_t abortedCalls = 0u;
+
+  /**
+   * Calls served from the response cache.
+   */
+  std::uint64_t cacheHits = 0u;
+
+  /**
+   * Calls not found in the response cache.
+   */
+  std::uint64_t cacheMisses = 0u;
+
+  /**
+   * Replies evicted from the response cache to make room for new ones.
+   */
+  std::uint64_t cacheEvictions = 0u;
+
+  /**
+   * Calls finished with the reply of an identical call in flight.
+   */
+  std::uint64_t coalescedCalls = 0u;
+
+  /**
+   * CPU time used by completion queue threads, microseconds.
+   */
+  std::uint64_t queueCpuTimeUs = 0u;
+
+  /**
+   * Completion queue events picked up by busy polling, without a wakeup.
+   */
+  std::uint64_t queueSpinHits = 0u;
+
+  /**
+   * Times a busy-polling queue thread blocked waiting for events.
+   */
+  std::uint64_t queueParks = 0u;
+
+  /**
+   * Time queue threads spent busy polling, microseconds.
+   */
+  std::uint64_t queueSpinTimeUs = 0u;
+
+  /**
+   * Dispatch lanes indexed by Priority.
+   */
+  std::array<LaneStats, kPrioritiesCount> lanes;
+
+  /**
+   * Batches drained from the dispatch lanes by size, bucket i counts sizes
+   * in [2^i, 2^(i+1)).
+   */
+  std::array<std::uint64_t, kBatchSizeBuckets> dispatchBatches{};
+
+  /**
+   * Calls by method, indexed by Rpc.
+   */
+  std::array<RpcMetrics, kRpcsCount> rpcs;
+
+  /**
+   * Time unary calls spent in each stage, nanoseconds, indexed by Stage.
+   */
+  std::array<LatencyHistogram, kStagesCount> stages;
+
+  /**
+   * Add counters of another server.
+   */
+  ServerStats& operator+=(ServerStats const& other) {
+    callDataSlots += other.callDataSlots;
+    callDataPoolExhausted += other.callDataPoolExhausted;
+    acceptedCalls += other.acceptedCalls;
+    shedCalls += other.shedCalls;
+    inFlightCalls += other.inFlightCalls;
+    abortedCalls += other.abortedCalls;
+    cacheHits += other.cacheHits;
+    cacheMisses += other.cacheMisses;
+    cacheEvictions += other.cacheEvictions;
+    coalescedCalls += other.coalescedCalls;
+    queueCpuTimeUs += other.queueCpuTimeUs;
+    queueSpinHits += other.queueSpinHits;
+    queueParks += other.queueParks;
+    queueSpinTimeUs += other.queueSpinTimeUs;
+    for (auto i = 0u; i < lanes.size(); ++i) {
+      lanes[i] += other.lanes[i];
+    }
+    for (auto i = 0u; i < dispatchBatches.size(); ++i) {
+      dispatchBatches[i] += other.dispatchBatches[i];
+    }
+    for (auto i = 0u; i < rpcs.size(); ++i) {
+      rpcs[i] += other.rpcs[i];
+    }
+    for (auto i = 0u; i < stages.size(); ++i) {
+      stages[i] += other.stages[i];
+    }
+    return *this;
+  }
+};
+
+} // namespace fservice
@@ -2,20 +2,29 @@
 
 // Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
 
+#include <fservice/EnumUtil.h>
 #include <fservice/GeneralError.h>
 #include <fservice/PathUtil.h>
 #include <fservice/StartupConfig.h>
+#include <fservice/ThreadPlacement.h>
 #include <fservice/Version.h>
 
 #include <boost/optional.hpp>
 #include <boost/program_options.hpp>
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
 #include <thread>
 
 namespace fservice {
 
+template <>
+EnumStrings<RunMode>::DataType EnumStrings<RunMode>::data = {"loop", "tick"};
+
 folly::Expected<StartupConfig, std::error_code> processCmdArgs(int argc,
                                                                char** argv) {
   namespace po = boost::program_options;
@@ -41,17 +50,206 @@ folly::Expected<StartupConfig, std::error_code> processCmdArgs(int argc,
   po::options_description serverOptions("Server options");
   std::string ip;
   std::uint32_t port;
+  std::uint32_t adminPort;
   std::uint32_t threads;
+  std::uint32_t cpuThreads;
+  std::uint32_t prepost;
+  std::uint32_t listeners;
+  std::string backend;
+  std::uint32_t streamPending;
+  std::uint32_t maxInFlight;
+  std::uint32_t maxInFlightPerQueue;
+  std::uint32_t drainTimeout;
+  bool raw;
+  std::uint32_t cacheCapacity;
+  std::uint32_t cacheTtl;
+  bool coalesce;
+  std::uint32_t laneWeightHigh;
+  std::uint32_t laneWeightNormal;
+  std::uint32_t laneWeightLow;
+  std::uint32_t laneCapacity;
+  std::uint32_t busyPollSpin;
+  bool busyPollPark;
+  std::string runMode;
+  std::uint32_t tickBudget;
+  std::uint32_t tickTimeSlice;
   serverOptions.add_options()(
       "ip,i", po::value(&ip)->default_value("127.0.0.1"), "Set ip to listen")(
       "port,p", po::value(&port)->default_value(12001), "Set port to listen")(
+      "admin-port",
+      po::value(&adminPort)->default_value(0),
+      "Port of the Admin service on the same ip. 0 disables it.")(
       "threads,t",
       po::value(&threads)->default_value(std::thread::hardware_concurrency()),
       "Number of threads to listen on. Numbers <= 0. Will use the number of "
-      "cores on this machine.");
+      "cores on this machine.")(
+      "cpu-threads",
+      po::value(&cpuThreads)->default_value(0),
+      "Number of threads which run request handlers. 0 runs handlers in the "
+      "event loops.")(
+      "listeners",
+      po::value(&listeners)->default_value(1),
+      "Number of servers sharing the port with SO_REUSEPORT. Threads are "
+      "split between them. Numbers <= 0 are treated as 1.")(
+      "prepost",
+      po::value(&prepost)->default_value(1),
+      "Number of calls kept armed on each completion queue. Numbers <= 0 "
+      "are treated as 1.")(
+      "backend",
+      po::value(&backend)->default_value(
+          EnumToString(ServerBackend::CompletionQueue)),
+      "Server implementation: 'cq' (completion queues) or 'callback' "
+      "(gRPC callback API).")(
+      "stream-pending",
+      po::value(&streamPending)->default_value(16),
+      "Max number of requests per stream which wait for reply. Reading from "
+      "the stream pauses when the limit is reached.")(
+      "max-inflight",
+      po::value(&maxInFlight)->default_value(0),
+      "Max number of calls in flight. Calls over the limit fail with "
+      "RESOURCE_EXHAUSTED. 0 means no limit.")(
+      "max-inflight-per-queue",
+      po::value(&maxInFlightPerQueue)->default_value(0),
+      "Max number of calls in flight per completion queue. 0 means no "
+      "limit.")(
+      "drain-timeout",
+      po::value(&drainTimeout)->default_value(5000),
+      "Milliseconds calls in flight are allowed to finish on shutdown. The "
+      "rest are cancelled.")(
+      "raw",
+      po::value(&raw)->default_value(false),
+      "Serve unary calls in wire format without protobuf parsing in the "
+      "server. Streams are not served. 'cq' backend only.")(
+      "cache-capacity",
+      po::value(&cacheCapacity)->default_value(0),
+      "Max number of SayHello replies in the response cache. 0 disables "
+      "the cache. 'cq' backend only.")(
+      "cache-ttl",
+      po::value(&cacheTtl)->default_value(0),
+      "Milliseconds cached reply stays valid. 0 means forever.")(
+      "coalesce",
+      po::value(&coalesce)->default_value(false),
+      "Handle identical SayHello calls in flight once. 'cq' backend only.")(
+      "lane-weight-high",
+      po::value(&laneWeightHigh)->default_value(8),
+      "Unary calls with 'x-priority: high' metadata dispatched per round. "
+      "'cq' backend only.")(
+      "lane-weight-normal",
+      po::value(&laneWeightNormal)->default_value(2),
+      "Unary calls with normal priority dispatched per round.")(
+      "lane-weight-low",
+      po::value(&laneWeightLow)->default_value(1),
+      "Unary calls with 'x-priority: low' metadata dispatched per round.")(
+      "lane-capacity",
+      po::value(&laneCapacity)->default_value(4096),
+      "Capacity of the ring of each dispatch lane.")(
+      "busy-poll-spin",
+      po::value(&busyPollSpin)->default_value(0),
+      "Microseconds queue threads spin waiting for the next event before "
+      "blocking. 0 disables busy polling. 'cq' backend only.")(
+      "busy-poll-park",
+      po::value(&busyPollPark)->default_value(true),
+      "Block queue threads after the spin time. If false they spin all the "
+      "time.")(
+      "run-mode",
+      po::value(&runMode)->default_value(EnumToString(RunMode::Loop)),
+      "'loop' runs calls in the event loops. 'tick' runs them in the main "
+      "thread in bounded ticks between timers and I/O. Tick is 'cq' backend "
+      "only.")(
+      "tick-budget",
+      po::value(&tickBudget)->default_value(256),
+      "Max number of queued calls, stream requests and async handler "
+      "continuations run per tick. Numbers <= 0 are treated as 1.")(
+      "tick-time-slice",
+      po::value(&tickTimeSlice)->default_value(1000),
+      "Microseconds after which a tick stops taking new batches of calls.");
+
+  po::options_description transportOptions(
+      "Transport options (0 keeps gRPC default)");
+  std::uint32_t maxConcurrentStreams;
+  std::uint32_t streamWindow;
+  std::uint32_t maxFrameSize;
+  bool bdpProbe;
+  std::uint32_t keepaliveTime;
+  std::uint32_t keepaliveTimeout;
+  bool keepalivePermitWithoutCalls;
+  std::uint32_t minPingInterval;
+  std::uint32_t maxReceiveMessageSize;
+  std::uint32_t maxSendMessageSize;
+  std::uint64_t quotaMemory;
+  std::uint32_t quotaThreads;
+  bool reusePort;
+  transportOptions.add_options()(
+      "max-concurrent-streams",
+      po::value(&maxConcurrentStreams)->default_value(0),
+      "Max number of concurrent streams per HTTP/2 connection.")(
+      "http2-stream-window",
+      po::value(&streamWindow)->default_value(0),
+      "HTTP/2 flow-control window of a stream in bytes.")(
+      "http2-max-frame-size",
+      po::value(&maxFrameSize)->default_value(0),
+      "Max HTTP/2 frame size in bytes.")(
+      "http2-bdp-probe",
+      po::value(&bdpProbe)->default_value(true),
+      "Grow flow-control windows by bandwidth-delay product probing.")(
+      "keepalive-time",
+      po::value(&keepaliveTime)->default_value(0),
+      "Milliseconds between keepalive pings sent by the server.")(
+      "keepalive-timeout",
+      po::value(&keepaliveTimeout)->default_value(0),
+      "Milliseconds to wait for keepalive ack before closing connection.")(
+      "keepalive-permit-without-calls",
+      po::value(&keepalivePermitWithoutCalls)->default_value(false),
+      "Allow keepalive pings on connections without calls.")(
+      "min-ping-interval",
+      po::value(&minPingInterval)->default_value(0),
+      "Min milliseconds between client pings without data.")(
+      "max-recv-message-size",
+      po::value(&maxReceiveMessageSize)->default_value(0),
+      "Max size of received message in bytes.")(
+      "max-send-message-size",
+      po::value(&maxSendMessageSize)->default_value(0),
+      "Max size of sent message in bytes.")(
+      "quota-memory",
+      po::value(&quotaMemory)->default_value(0),
+      "Memory limit of gRPC resource quota in bytes.")(
+      "quota-threads",
+      po::value(&quotaThreads)->default_value(0),
+      "Limit of gRPC threads of resource quota.")(
+      "reuseport",
+      po::value(&reusePort)->default_value(true),
+      "Set SO_REUSEPORT on the listening socket.");
+
+  po::options_description placementOptions(
+      "Thread placement options (core lists like 0-3,8; empty keeps threads "
+      "unpinned)");
+  std::string queueCores;
+  std::string eventLoopCores;
+  std::string cpuPoolCores;
+  std::string mainCores;
+  bool localMemory;
+  placementOptions.add_options()(
+      "queue-cores",
+      po::value(&queueCores)->default_value(""),
+      "Cores of completion queue threads. 'cq' backend only.")(
+      "event-loop-cores",
+      po::value(&eventLoopCores)->default_value(""),
+      "Cores of event loop threads.")(
+      "cpu-pool-cores",
+      po::value(&cpuPoolCores)->default_value(""),
+      "Cores of CPU pool threads.")(
+      "main-cores",
+      po::value(&mainCores)->default_value(""),
+      "Cores of the main thread.")(
+      "numa-local-memory",
+      po::value(&localMemory)->default_value(false),
+      "Pinned threads prefer memory of the NUMA node of their core.");
+
+  po::options_description fileOptions;
+  fileOptions.add(serverOptions).add(transportOptions).add(placementOptions);
 
   po::options_description allOptions("Allowed options");
-  allOptions.add(generalOptions).add(serverOptions);
+  allOptions.add(generalOptions).add(fileOptions);
 
   po::variables_map vm;
   try {
@@ -68,7 +266,7 @@ folly::Expected<StartupConfig, std::error_code> processCmdArgs(int argc,
       std::cerr << "Cannot open configuration file : " << configFilePath
                 << "\n";
     } else {
-      po::store(po::parse_config_file(configFileStream, serverOptions), vm);
+      po::store(po::parse_config_file(configFileStream, fileOptions), vm);
       po::notify(vm);
     }
   } catch (po::error const& error) {
@@ -88,10 +286,106 @@ folly::Expected<StartupConfig, std::error_code> processCmdArgs(int argc,
     return folly::makeUnexpected(make_error_code(GeneralError::Interrupted));
   }
 
+  auto const threadsCount =
+      threads > 0u ? threads
+                   : std::max(1u, std::thread::hardware_concurrency());
+
+  ServerConfig serverConfig;
+  // Each listener needs at least one thread.
+  serverConfig.listenersCount =
+      std::min(std::max(1u, listeners), threadsCount);
+  serverConfig.queuesCount = threadsCount;
+  serverConfig.prepostCount = std::max(1u, prepost);
+  serverConfig.streamMaxPendingReplies = std::max(1u, streamPending);
+  serverConfig.maxInFlight = maxInFlight;
+  serverConfig.maxInFlightPerQueue = maxInFlightPerQueue;
+  serverConfig.drainTimeout = std::chrono::milliseconds(drainTimeout);
+  serverConfig.rawMode = raw;
+  serverConfig.cacheCapacity = cacheCapacity;
+  serverConfig.cacheTtl = std::chrono::milliseconds(cacheTtl);
+  serverConfig.coalesceRequests = coalesce;
+  serverConfig.laneCapacity = std::max(1u, laneCapacity);
+  serverConfig.busyPollSpin = std::chrono::microseconds(busyPollSpin);
+  serverConfig.busyPollPark = busyPollPark;
+  serverConfig.laneWeights = {std::max(1u, laneWeightHigh),
+                              std::max(1u, laneWeightNormal),
+                              std::max(1u, laneWeightLow)};
+
+  auto& transport = serverConfig.transport;
+  transport.maxConcurrentStreams = maxConcurrentStreams;
+  transport.streamWindowBytes = streamWindow;
+  transport.maxFrameSize = maxFrameSize;
+  transport.bdpProbe = bdpProbe;
+  transport.keepaliveTime = std::chrono::milliseconds(keepaliveTime);
+  transport.keepaliveTimeout = std::chrono::milliseconds(keepaliveTimeout);
+  transport.keepalivePermitWithoutCalls = keepalivePermitWithoutCalls;
+  transport.minPingInterval = std::chrono::milliseconds(minPingInterval);
+  transport.maxReceiveMessageSize = maxReceiveMessageSize;
+  transport.maxSendMessageSize = maxSendMessageSize;
+  transport.quotaMemory = quotaMemory;
+  transport.quotaThreads = quotaThreads;
+  transport.reusePort = reusePort;
+  try {
+    validateTransportConfig(transport);
+  } catch (std::invalid_argument const& error) {
+    printError(error);
+    printHelp(allOptions);
+    return folly::makeUnexpected(
+        make_error_code(GeneralError::WrongStartupParams));
+  }
+
+  auto& placement = serverConfig.placement;
+  try {
+    placement.queueCores = parseCoreList(queueCores);
+    placement.eventLoopCores = parseCoreList(eventLoopCores);
+    placement.cpuPoolCores = parseCoreList(cpuPoolCores);
+    placement.mainCores = parseCoreList(mainCores);
+  } catch (std::invalid_argument const& error) {
+    printError(error);
+    printHelp(allOptions);
+    return folly::makeUnexpected(
+        make_error_code(GeneralError::WrongStartupParams));
+  }
+  placement.localMemory = localMemory;
+
+  std::istringstream backendStream(backend);
+  backendStream >> EnumFromStream(serverConfig.backend);
+  if (EnumToString(serverConfig.backend) != backend) {
+    printError(std::invalid_argument("Unknown backend: " + backend));
+    printHelp(allOptions);
+    return folly::makeUnexpected(
+        make_error_code(GeneralError::WrongStartupParams));
+  }
+
+  if (adminPort > 65535u) {
+    printError(std::invalid_argument("Invalid admin port: " +
+                                     std::to_string(adminPort)));
+    printHelp(allOptions);
+    return folly::makeUnexpected(
+        make_error_code(GeneralError::WrongStartupParams));
+  }
+
+  RunMode parsedRunMode = RunMode::Loop;
+  std::istringstream runModeStream(runMode);
+  runModeStream >> EnumFromStream(parsedRunMode);
+  if (EnumToString(parsedRunMode) != runMode) {
+    printError(std::invalid_argument("Unknown run mode: " + runMode));
+    printHelp(allOptions);
+    return folly::makeUnexpected(
+        make_error_code(GeneralError::WrongStartupParams));
+  }
+  serverConfig.manualDispatch = parsedRunMode == RunMode::Tick;
+
   try {
     bool const allowNameLookup = true;
     return StartupConfig{folly::SocketAddress(ip, port, allowNameLookup),
-                         threads};
+                         static_cast<std::uint16_t>(adminPort),
+                         threadsCount,
+                         cpuThreads,
+                         parsedRunMode,
+                         std::max(1u, tickBudget),
+                         std::chrono::microseconds(tickTimeSlice),
+                         serverConfig};
   } catch (std::exception const& error) {
     printError(error);
     printHelp(allOptions);
@@ -100,4 +394,40 @@ folly::Expected<StartupConfig, std::error_code> processCmdArgs(int argc,
   }
 }
 
+std::map<std::string, std::string> getOptions(StartupConfig const& config) {
+  auto const& server = config.server;
+  auto const toString = [](bool value) { return value ? "true" : "false"; };
+  return {
+      {"ip", config.address.getAddressStr()},
+      {"port", std::to_string(config.address.getPort())},
+      {"admin-port", std::to_string(config.adminPort)},
+      {"threads", std::to_string(config.threadsCount)},
+      {"cpu-threads", std::to_string(config.cpuThreadsCount)},
+      {"run-mode", EnumToString(config.runMode)},
+      {"tick-budget", std::to_string(config.tickBudget)},
+      {"tick-time-slice", std::to_string(config.tickTimeSlice.count())},
+      {"backend", EnumToString(server.backend)},
+      {"listeners", std::to_string(server.listenersCount)},
+      {"prepost", std::to_string(server.prepostCount)},
+      {"stream-pending", std::to_string(server.streamMaxPendingReplies)},
+      {"max-inflight", std::to_string(server.maxInFlight)},
+      {"max-inflight-per-queue", std::to_string(server.maxInFlightPerQueue)},
+      {"drain-timeout", std::to_string(server.drainTimeout.count())},
+      {"raw", toString(server.rawMode)},
+      {"cache-capacity", std::to_string(server.cacheCapacity)},
+      {"cache-ttl", std::to_string(server.cacheTtl.count())},
+      {"coalesce", toString(server.coalesceRequests)},
+      {"lane-weight-high",
+       std::to_string(server.laneWeights[ToIntegral(Priority::High)])},
+      {"lane-weight-normal",
+       std::to_string(server.laneWeights[ToIntegral(Priority::Normal)])},
+      {"lane-weight-low",
+       std::to_string(server.laneWeights[ToIntegral(Priority::Low)])},
+      {"lane-capacity", std::to_string(server.laneCapacity)},
+      {"busy-poll-spin", std::to_string(server.busyPollSpin.count())},
+      {"busy-poll-park", toString(server.busyPollPark)},
+      {"reuseport", toString(server.transport.reusePort)},
+      {"numa-local-memory", toString(server.placement.localMemory)}};
+}
+
 } // namespace  fservice
\ No newline at end of file
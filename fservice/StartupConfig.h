@@ -4,21 +4,68 @@
 
 #pragma once
 
+#include <fservice/ServerConfig.h>
+
 #include <folly/Expected.h>
 #include <folly/SocketAddress.h>
 
+#include <chrono>
+#include <cstddef>
+#include <map>
 #include <stdint.h>
 #include <string>
 
 namespace fservice {
 
+/**
+ * How the main thread runs the engine.
+ */
+enum class RunMode {
+  /** Event loop runs until stopped, calls are run by the event loops. */
+  Loop,
+  /** Main thread alternates event loop iterations with bounded ticks of
+   * queued calls. */
+  Tick
+};
+
 struct StartupConfig {
   folly::SocketAddress const address;
 
+  /**
+   * Port of the Admin service on the same host. 0 if disabled.
+   */
+  std::uint16_t const adminPort = 0u;
+
   std::uint32_t const threadsCount = 0u;
+
+  /**
+   * Threads of the pool which runs request handlers. 0 if handlers run in
+   * the event loops.
+   */
+  std::uint32_t const cpuThreadsCount = 0u;
+
+  RunMode const runMode = RunMode::Loop;
+
+  /**
+   * Max number of queued calls run per tick. Tick mode only.
+   */
+  std::size_t const tickBudget = 256u;
+
+  /**
+   * Time after which a tick stops taking new batches of calls. Tick mode
+   * only.
+   */
+  std::chrono::microseconds const tickTimeSlice{1000};
+
+  ServerConfig const server;
 };
 
 folly::Expected<StartupConfig, std::error_code> processCmdArgs(int argc,
                                                                char** argv);
 
+/**
+ * Effective values of the main options by option name.
+ */
+std::map<std::string, std::string> getOptions(StartupConfig const& config);
+
 } // namespace fservice
\ No newline at end of file
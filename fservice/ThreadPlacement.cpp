@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/Logger.h>
+#include <fservice/ThreadPlacement.h>
+
+#include <folly/Conv.h>
+#include <folly/String.h>
+#include <folly/system/ThreadName.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+DECLARE_GLOBAL_GET_LOGGER("ThreadPlacement")
+
+namespace fservice {
+
+namespace {
+
+/* From linux/mempolicy.h: allocate on the given node while it has free
+ * memory. Not exposed by glibc, libnuma is not needed for it. */
+constexpr int kMemoryPolicyPreferred = 1;
+
+/* Nodes of the mask passed to set_mempolicy. */
+constexpr std::size_t kMaxNodesCount = 1024u;
+
+constexpr std::size_t kNodeMaskWordBits = 8u * sizeof(unsigned long);
+
+cpu_set_t readCurrentThreadCores() {
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet) != 0) {
+    // Unknown, let the thread run anywhere.
+    for (auto core = 0; core < CPU_SETSIZE; ++core) {
+      CPU_SET(core, &cpuSet);
+    }
+  }
+  return cpuSet;
+}
+
+/* Cores of the process before any thread is pinned. Read at load time. */
+cpu_set_t const processCores = readCurrentThreadCores();
+
+void preferNodeOfCurrentCore() {
+  unsigned cpu = 0u;
+  unsigned node = 0u;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+    LOG_WARNF("Cannot get NUMA node of the thread: {}", std::strerror(errno));
+    return;
+  }
+  if (node >= kMaxNodesCount) {
+    LOG_WARNF("NUMA node {} is out of supported range", node);
+    return;
+  }
+  std::array<unsigned long, kMaxNodesCount / kNodeMaskWordBits> nodeMask{};
+  nodeMask[node / kNodeMaskWordBits] = 1ul << (node % kNodeMaskWordBits);
+  // Kernel reads one bit less than maxnode.
+  if (syscall(SYS_set_mempolicy,
+              kMemoryPolicyPreferred,
+              nodeMask.data(),
+              kMaxNodesCount + 1u) != 0) {
+    LOG_WARNF("Cannot prefer memory of NUMA node {}: {}",
+              node,
+              std::strerror(errno));
+    return;
+  }
+  LOG_DEBUGF("Thread prefers memory of NUMA node {}", node);
+}
+
+std::uint32_t parseCore(folly::StringPiece const value,
+                        std::string const& list) {
+  try {
+    return folly::to<std::uint32_t>(folly::trimWhitespace(value));
+  } catch (std::exception const&) {
+    throw std::invalid_argument("Malformed core list: " + list);
+  }
+}
+
+} // namespace
+
+std::vector<std::uint32_t> parseCoreList(std::string const& list) {
+  std::vector<std::uint32_t> cores;
+  if (folly::trimWhitespace(list).empty()) {
+    return cores;
+  }
+  std::vector<folly::StringPiece> ranges;
+  folly::split(',', list, ranges);
+  for (auto const range : ranges) {
+    folly::StringPiece first;
+    folly::StringPiece last;
+    if (!folly::split('-', range, first, last)) {
+      first = last = range;
+    }
+    auto const firstCore = parseCore(first, list);
+    auto const lastCore = parseCore(last, list);
+    if (firstCore > lastCore || lastCore >= CPU_SETSIZE) {
+      throw std::invalid_argument("Malformed core list: " + list);
+    }
+    for (auto core = firstCore; core <= lastCore; ++core) {
+      cores.push_back(core);
+    }
+  }
+  return cores;
+}
+
+void pinCurrentThread(std::vector<std::uint32_t> const& cores,
+                      std::size_t const index,
+                      bool const localMemory) {
+  if (cores.empty()) {
+    // Spawning thread may be pinned.
+    if (auto const error = pthread_setaffinity_np(
+            pthread_self(), sizeof(processCores), &processCores);
+        error != 0) {
+      LOG_WARNF("Cannot unpin thread: {}", std::strerror(error));
+    }
+    return;
+  }
+  auto const core = cores[index % cores.size()];
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  CPU_SET(core, &cpuSet);
+  if (auto const error =
+          pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+      error != 0) {
+    LOG_WARNF("Cannot pin thread to core {}: {}", core, std::strerror(error));
+    return;
+  }
+  LOG_DEBUGF("Thread pinned to core {}", core);
+  if (localMemory) {
+    // Thread has moved to the core by now.
+    preferNodeOfCurrentCore();
+  }
+}
+
+void placeCurrentThread(std::string const& name,
+                        std::vector<std::uint32_t> const& cores,
+                        std::size_t const index,
+                        bool const localMemory) {
+  folly::setThreadName(name);
+  pinCurrentThread(cores, index, localMemory);
+}
+
+PlacedThreadFactory::PlacedThreadFactory(std::string prefix,
+                                         std::vector<std::uint32_t> cores,
+                                         bool const localMemory)
+    : folly::NamedThreadFactory(std::move(prefix)),
+      cores_(std::move(cores)),
+      localMemory_(localMemory) {
+}
+
+std::thread PlacedThreadFactory::newThread(folly::Func&& func) {
+  auto const index = nextIndex_.fetch_add(1u, std::memory_order_relaxed);
+  return folly::NamedThreadFactory::newThread(
+      [this, index, func = std::move(func)]() mutable {
+        placeCurrentThread(getNamePrefix() + std::to_string(index),
+                           cores_,
+                           index,
+                           localMemory_);
+        func();
+      });
+}
+
+} // namespace fservice
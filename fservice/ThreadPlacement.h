@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fservice {
+
+/**
+ * Cores the threads of each role are pinned to. Thread i of a role takes
+ * core i modulo the list size. Empty list leaves threads of the role
+ * unpinned.
+ */
+struct ThreadPlacement {
+  /**
+   * Threads polling completion queues.
+   */
+  std::vector<std::uint32_t> queueCores;
+
+  /**
+   * Event loop threads which handle requests.
+   */
+  std::vector<std::uint32_t> eventLoopCores;
+
+  /**
+   * Threads of the CPU pool which runs handlers.
+   */
+  std::vector<std::uint32_t> cpuPoolCores;
+
+  /**
+   * Main thread which runs lifecycle events and stats.
+   */
+  std::vector<std::uint32_t> mainCores;
+
+  /**
+   * Make pinned threads prefer memory of the NUMA node of their core, over
+   * the memory policy inherited from the process.
+   */
+  bool localMemory = false;
+};
+
+/**
+ * Parse list of cores like "0-3,8,10-11".
+ * @throw std::invalid_argument if the list is malformed.
+ */
+std::vector<std::uint32_t> parseCoreList(std::string const& list);
+
+/**
+ * Pin the calling thread to cores[index % cores.size()] and, if asked, make
+ * it prefer memory of the NUMA node of the core. Threads inherit affinity of
+ * the thread which spawns them, so empty list gives the calling thread all
+ * cores the process has started with. Failures are logged, the thread keeps
+ * running where the kernel puts it.
+ */
+void pinCurrentThread(std::vector<std::uint32_t> const& cores,
+                      std::size_t index,
+                      bool localMemory);
+
+/**
+ * Name the calling thread and pin it, see pinCurrentThread.
+ */
+void placeCurrentThread(std::string const& name,
+                        std::vector<std::uint32_t> const& cores,
+                        std::size_t index,
+                        bool localMemory);
+
+/**
+ * Thread factory of folly executors which names and places its threads.
+ */
+class PlacedThreadFactory final : public folly::NamedThreadFactory {
+ public:
+  PlacedThreadFactory(std::string prefix,
+                      std::vector<std::uint32_t> cores,
+                      bool localMemory);
+
+  std::thread newThread(folly::Func&& func) override;
+
+ private:
+  std::vector<std::uint32_t> const cores_;
+
+  bool const localMemory_;
+
+  std::atomic<std::size_t> nextIndex_{0u};
+};
+
+} // namespace fservice
@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/TransportConfig.h>
+
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/resource_quota.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace fservice {
+
+namespace {
+
+constexpr std::int64_t kMaxIntArgument = std::numeric_limits<int>::max();
+
+int toIntArgument(std::int64_t const value) {
+  return static_cast<int>(std::min(value, kMaxIntArgument));
+}
+
+void addIntArgument(grpc::ServerBuilder& builder,
+                    char const* name,
+                    std::int64_t value) {
+  if (value > 0) {
+    builder.AddChannelArgument(name, toIntArgument(value));
+  }
+}
+
+void checkIntArgument(char const* option, std::int64_t const value) {
+  if (value > kMaxIntArgument) {
+    throw std::invalid_argument(fmt::format(
+        "Option {} is {}, max is {}", option, value, kMaxIntArgument));
+  }
+}
+
+} // namespace
+
+void validateTransportConfig(TransportConfig const& config) {
+  checkIntArgument("max-concurrent-streams", config.maxConcurrentStreams);
+  checkIntArgument("http2-stream-window", config.streamWindowBytes);
+  checkIntArgument("http2-max-frame-size", config.maxFrameSize);
+  checkIntArgument("keepalive-time", config.keepaliveTime.count());
+  checkIntArgument("keepalive-timeout", config.keepaliveTimeout.count());
+  checkIntArgument("min-ping-interval", config.minPingInterval.count());
+  checkIntArgument("max-recv-message-size", config.maxReceiveMessageSize);
+  checkIntArgument("max-send-message-size", config.maxSendMessageSize);
+  checkIntArgument("quota-threads", config.quotaThreads);
+}
+
+void applyTransportConfig(TransportConfig const& config,
+                          grpc::ServerBuilder& builder) {
+  addIntArgument(
+      builder, GRPC_ARG_MAX_CONCURRENT_STREAMS, config.maxConcurrentStreams);
+  addIntArgument(
+      builder, GRPC_ARG_HTTP2_STREAM_LOOKAHEAD_BYTES, config.streamWindowBytes);
+  addIntArgument(builder, GRPC_ARG_HTTP2_MAX_FRAME_SIZE, config.maxFrameSize);
+  builder.AddChannelArgument(GRPC_ARG_HTTP2_BDP_PROBE, config.bdpProbe ? 1 : 0);
+
+  addIntArgument(
+      builder, GRPC_ARG_KEEPALIVE_TIME_MS, config.keepaliveTime.count());
+  addIntArgument(
+      builder, GRPC_ARG_KEEPALIVE_TIMEOUT_MS, config.keepaliveTimeout.count());
+  builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS,
+                             config.keepalivePermitWithoutCalls ? 1 : 0);
+  addIntArgument(builder,
+                 GRPC_ARG_HTTP2_MIN_RECV_PING_INTERVAL_WITHOUT_DATA_MS,
+                 config.minPingInterval.count());
+
+  if (config.maxReceiveMessageSize > 0u) {
+    builder.SetMaxReceiveMessageSize(
+        toIntArgument(config.maxReceiveMessageSize));
+  }
+  if (config.maxSendMessageSize > 0u) {
+    builder.SetMaxSendMessageSize(toIntArgument(config.maxSendMessageSize));
+  }
+
+  if (config.quotaMemory > 0u || config.quotaThreads > 0u) {
+    grpc::ResourceQuota quota("fservice");
+    if (config.quotaMemory > 0u) {
+      quota.Resize(config.quotaMemory);
+    }
+    if (config.quotaThreads > 0u) {
+      quota.SetMaxThreads(toIntArgument(config.quotaThreads));
+    }
+    // Builder keeps its own reference to the quota.
+    builder.SetResourceQuota(quota);
+  }
+
+  builder.AddChannelArgument(GRPC_ARG_ALLOW_REUSEPORT,
+                             config.reusePort ? 1 : 0);
+}
+
+} // namespace fservice
@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace grpc {
+
+class ServerBuilder;
+
+} // namespace grpc
+
+namespace fservice {
+
+/**
+ * HTTP/2 and resource options of the gRPC server. Zero values leave gRPC
+ * defaults.
+ */
+struct TransportConfig {
+  /**
+   * Max number of concurrent streams per HTTP/2 connection.
+   */
+  std::uint32_t maxConcurrentStreams = 0u;
+
+  /**
+   * HTTP/2 flow-control window of a stream in bytes.
+   */
+  std::uint32_t streamWindowBytes = 0u;
+
+  /**
+   * Max HTTP/2 frame size in bytes.
+   */
+  std::uint32_t maxFrameSize = 0u;
+
+  /**
+   * Let gRPC grow flow-control windows by bandwidth-delay product probing.
+   */
+  bool bdpProbe = true;
+
+  /**
+   * Interval of keepalive pings sent by the server.
+   */
+  std::chrono::milliseconds keepaliveTime{0};
+
+  /**
+   * How long to wait for the keepalive ack before closing the connection.
+   */
+  std::chrono::milliseconds keepaliveTimeout{0};
+
+  /**
+   * Allow keepalive pings on connections without calls.
+   */
+  bool keepalivePermitWithoutCalls = false;
+
+  /**
+   * Min interval between pings without data accepted from clients.
+   */
+  std::chrono::milliseconds minPingInterval{0};
+
+  /**
+   * Max size of received message in bytes.
+   */
+  std::uint32_t maxReceiveMessageSize = 0u;
+
+  /**
+   * Max size of sent message in bytes.
+   */
+  std::uint32_t maxSendMessageSize = 0u;
+
+  /**
+   * Memory limit of the server resource quota in bytes.
+   */
+  std::uint64_t quotaMemory = 0u;
+
+  /**
+   * Limit of gRPC threads of the server resource quota.
+   */
+  std::uint32_t quotaThreads = 0u;
+
+  /**
+   * Allow several servers to listen on the same port (SO_REUSEPORT).
+   */
+  bool reusePort = true;
+};
+
+/**
+ * Check that options fit gRPC arguments, which are int.
+ * @throw std::invalid_argument Option is out of range.
+ */
+void validateTransportConfig(TransportConfig const& config);
+
+/**
+ * Set transport options to the builder before the server is started.
+ * Options out of range are clamped.
+ */
+void applyTransportConfig(TransportConfig const& config,
+                          grpc::ServerBuilder& builder);
+
+} // namespace fservice
@@ -0,0 +1,716 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <fservice/AdmissionController.h>
+#include <fservice/CompletionTag.h>
+#include <fservice/CycleClock.h>
+#include <fservice/DispatchQueue.h>
+#include <fservice/EnumUtil.h>
+#include <fservice/IServerEventHandler.h>
+#include <fservice/Logger.h>
+#include <fservice/Metrics.h>
+#include <fservice/RequestCoalescer.h>
+#include <fservice/ResponseCache.h>
+
+#include <protos/Greeter.grpc.pb.h>
+
+#include <folly/Try.h>
+#include <folly/Unit.h>
+#include <folly/executors/InlineExecutor.h>
+#include <folly/futures/Future.h>
+#include <folly/io/async/EventBase.h>
+
+#include <google/protobuf/arena.h>
+#include <grpcpp/grpcpp.h>
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fservice {
+
+template <typename Request, typename Reply>
+class UnaryCallDataPool;
+
+/**
+ * Holds context of unary client request. Instances are owned by
+ * UnaryCallDataPool and reused for many requests.
+ */
+template <typename Request, typename Reply>
+class UnaryCallData final : public ICompletionTag {
+ public:
+  using Responder = grpc::ServerAsyncResponseWriter<Reply>;
+
+  /**
+   * Method of the service which asks gRPC to deliver the next call.
+   */
+  using RequestMethod =
+      void (Greeter::AsyncService::*)(grpc::ServerContext*,
+                                      Request*,
+                                      Responder*,
+                                      grpc::CompletionQueue*,
+                                      grpc::ServerCompletionQueue*,
+                                      void*);
+
+  /**
+   * Method of the handler which serves the call. Started in the event loop,
+   * may complete on another executor.
+   */
+  using HandleMethod =
+      folly::SemiFuture<folly::Unit> (IServerEventHandler::*)(Request const&,
+                                                              Reply&);
+
+  using Pool = UnaryCallDataPool<Request, Reply>;
+
+  explicit UnaryCallData(Pool* pool);
+
+  UnaryCallData(UnaryCallData const&) = delete;
+  UnaryCallData& operator=(UnaryCallData const&) = delete;
+
+  /**
+   * Request the system to deliver the next call into this slot.
+   */
+  void arm();
+
+  void proceed(bool const ok) override;
+
+  /**
+   * Drop the state of the served call so the slot can be armed again.
+   */
+  void reset();
+
+ private:
+  /* Completion of AsyncNotifyWhenDone. Call is finished or cancelled. */
+  void onDone(bool ok);
+
+  /* Status to finish the call with instead of handling it: client has
+   * cancelled the call or its deadline has passed. OK if the call is alive. */
+  grpc::Status getAbortStatus() const;
+
+  /* Finish without handling. */
+  void abort(grpc::Status const& status);
+
+  /* Start the handler in the event loop. */
+  void handle();
+
+  /* Handler has completed. Finish the call together with the calls
+   * coalesced with it. Runs in the event loop. */
+  void onHandled(folly::Try<folly::Unit> const& result);
+
+  /* Finish coalesced call with the reply of the leader. */
+  void finishWith(Reply const& reply);
+
+  /* Finish call whose handler has failed. */
+  void fail(grpc::Status const& status);
+
+  /* Finish the call with reply and OK status. */
+  void finish();
+
+  /* Finish the call with error status. */
+  void finishWithError(grpc::Status const& status);
+
+  /* One of the tags came back. Slot returns to the pool after the last one. */
+  void onTagDone();
+
+  /* Stage starts now. */
+  void mark(Stage stage);
+
+  /* Count the stages the call went through. Runs when the Finish tag comes
+   * back, which ends the Send stage. */
+  void recordStages();
+
+  DECLARE_GET_LOGGER("Server.CallData")
+
+  /* Size of the inline block used by the arena before touching the heap.
+   * Enough for typical request and reply. */
+  static constexpr std::size_t kArenaBlockSize = 1024u;
+
+  static google::protobuf::ArenaOptions makeArenaOptions(char* block,
+                                                         std::size_t size);
+
+  /* Owner of this slot. Provides service, queue, handler and event loop. */
+  Pool* const pool_;
+
+  alignas(std::max_align_t) char arenaBlock_[kArenaBlockSize];
+
+  /* Holds request and reply. Reset for each call. */
+  google::protobuf::Arena arena_;
+
+  /* Context for the rpc, allowing to tweak aspects of it such as the use of
+   * compression, authentication, as well as to send metadata back to the
+   * client. Context can't be reused, so it is recreated in place. */
+  std::optional<grpc::ServerContext> context_;
+
+  /* Request from the client. Allocated in arena_. */
+  Request* request_ = nullptr;
+
+  /* Response to the client. Allocated in arena_. */
+  Reply* reply_ = nullptr;
+
+  /* The means to get back to the client. */
+  std::optional<Responder> responder_;
+
+  /* Request states */
+  enum class CallStatus { CREATE, PROCESS, FINISH };
+
+  /*The current serving state. */
+  CallStatus status_ = CallStatus::CREATE;
+
+  /* Call holds a slot of the admission controller. */
+  bool admitted_ = false;
+
+  /* When the call was taken from the completion queue. */
+  std::chrono::steady_clock::time_point acceptedAt_;
+
+  /* Call is finished with OK status. */
+  bool finishedOk_ = false;
+
+  /* CycleClock ticks when the stages from Admit to Send have started, 0 if
+   * the call skipped the stage. Written before the Finish call, so the queue
+   * thread reads them safely once its tag is back. */
+  std::array<std::uint64_t, ToIntegral(Stage::Serialize)> stageMarks_{};
+
+  /* serializeTicks_ while the Finish call has not returned yet. */
+  static constexpr std::uint64_t kSerializePending =
+      std::numeric_limits<std::uint64_t>::max();
+
+  /* serializeTicks_ once the queue thread has taken it, or if the call has
+   * not serialized a reply. */
+  static constexpr std::uint64_t kSerializeTaken = kSerializePending - 1u;
+
+  /* Duration of the Finish call, passed from the thread which has made it
+   * to the queue thread. The slot may be finished by the time the call
+   * returns, so the duration is passed only if the queue thread has not
+   * taken the stages yet. Otherwise it stays counted in Send. */
+  std::atomic<std::uint64_t> serializeTicks_{kSerializeTaken};
+
+  /* Serialized request used as the key of the cache and the coalescer.
+   * Keeps its capacity between calls. */
+  std::string requestKey_;
+
+  /* Tags given to gRPC and not returned yet. Both Finish and done tags must
+   * come back before the slot is reused. Touched only by the queue thread. */
+  std::uint32_t pendingTags_ = 0u;
+
+  /* Set by the queue thread when the done tag reports cancellation. Read by
+   * the event loop before running the handler and before Finish. */
+  std::atomic<bool> cancelled_{false};
+
+  MemberCompletionTag<UnaryCallData, &UnaryCallData::onDone> doneTag_;
+};
+
+/**
+ * Slab of UnaryCallData of one method which belongs to one completion queue.
+ * Finished calls are reset and returned to the free list instead of being
+ * deallocated. Not thread safe: used only by the thread of its queue.
+ */
+template <typename Request, typename Reply>
+class UnaryCallDataPool {
+ public:
+  using CallData = UnaryCallData<Request, Reply>;
+
+  using Coalescer = RequestCoalescer<CallData>;
+
+  UnaryCallDataPool(DispatchQueue* dispatchQueue,
+                    Greeter::AsyncService* service,
+                    grpc::ServerCompletionQueue* completionQueue,
+                    IServerEventHandler* serverEventHandler,
+                    typename CallData::RequestMethod requestMethod,
+                    typename CallData::HandleMethod handleMethod,
+                    AdmissionController* admissionController,
+                    ResponseCache* responseCache,
+                    Coalescer* coalescer,
+                    Metrics* metrics,
+                    Rpc rpc,
+                    std::size_t initialSize);
+
+  UnaryCallDataPool(UnaryCallDataPool const&) = delete;
+  UnaryCallDataPool& operator=(UnaryCallDataPool const&) = delete;
+
+  /**
+   * Take free slot. Slab grows if there are no free slots.
+   */
+  CallData* acquire();
+
+  /**
+   * Reset slot and return it to the free list.
+   */
+  void release(CallData* callData);
+
+  /**
+   * All slots are free, so no operation of the pool is pending in the queue.
+   */
+  bool isIdle() const;
+
+  /**
+   * Number of allocated slots. Thread safe.
+   */
+  std::uint64_t getSlotsCount() const;
+
+  /**
+   * How many times acquire found no free slot. Thread safe.
+   */
+  std::uint64_t getExhaustedCount() const;
+
+  /**
+   * Number of calls finished without handling because they were cancelled or
+   * their deadline had passed. Thread safe.
+   */
+  std::uint64_t getAbortedCount() const;
+
+ private:
+  friend class UnaryCallData<Request, Reply>;
+
+  CallData* allocate();
+
+  /* Lanes of the event loop which handles the calls. */
+  DispatchQueue* const dispatchQueue_;
+
+  Greeter::AsyncService* const service_;
+
+  /* The producer-consumer queue where for asynchronous server
+   * notifications.*/
+  grpc::ServerCompletionQueue* const completionQueue_;
+
+  IServerEventHandler* const serverEventHandler_;
+
+  typename CallData::RequestMethod const requestMethod_;
+
+  typename CallData::HandleMethod const handleMethod_;
+
+  /* Bounds calls of the queue which wait for or run in the event loop. */
+  AdmissionController* const admissionController_;
+
+  /* Replies of calls served before. Optional. */
+  ResponseCache* const responseCache_;
+
+  /* Identical calls in flight, shared by the pools of all queues. Optional. */
+  Coalescer* const coalescer_;
+
+  /* Calls are counted there as rpc_. */
+  Metrics* const metrics_;
+
+  Rpc const rpc_;
+
+  /* Deque keeps addresses of slots stable while growing. */
+  std::deque<CallData> slots_;
+
+  std::vector<CallData*> freeSlots_;
+
+  /* Counters are written by the queue thread and read by stats. */
+  std::atomic<std::uint64_t> slotsCount_{0u};
+
+  std::atomic<std::uint64_t> exhaustedCount_{0u};
+
+  /* Written by the queue thread and the event loop. */
+  std::atomic<std::uint64_t> abortedCount_{0u};
+};
+
+template <typename Request, typename Reply>
+UnaryCallData<Request, Reply>::UnaryCallData(Pool* pool)
+    : pool_(pool),
+      arena_(makeArenaOptions(arenaBlock_, sizeof(arenaBlock_))),
+      doneTag_(this) {
+}
+
+template <typename Request, typename Reply>
+google::protobuf::ArenaOptions UnaryCallData<Request, Reply>::makeArenaOptions(
+    char* block,
+    std::size_t size) {
+  google::protobuf::ArenaOptions options;
+  // Arena keeps the initial block on Reset, so small calls never allocate.
+  options.initial_block = block;
+  options.initial_block_size = size;
+  return options;
+}
+
+template <typename Request, typename Reply>
+void UnaryCallData<Request, Reply>::arm() {
+  assert(status_ == CallStatus::CREATE);
+  context_.emplace();
+  responder_.emplace(&*context_);
+  request_ = google::protobuf::Arena::CreateMessage<Request>(&arena_);
+  reply_ = google::protobuf::Arena::CreateMessage<Reply>(&arena_);
+
+  // Must be set before the call starts. The tag is returned only if the call
+  // starts, so it is counted in PROCESS.
+  context_->AsyncNotifyWhenDone(doneTag_.tag());
+
+  // Make this instance progress to the PROCESS state.
+  status_ = CallStatus::PROCESS;
+  pendingTags_ = 1u;
+
+  // As part of the initial CREATE state, we *request* that the system
+  // start processing requests. In this request, "this" acts are
+  // the tag uniquely identifying the request (so that different CallData
+  // instances can serve different requests concurrently), in this case
+  // the memory address of this CallData instance.
+  (pool_->service_->*pool_->requestMethod_)(&*context_,
+                                            request_,
+                                            &*responder_,
+                                            pool_->completionQueue_,
+                                            pool_->completionQueue_,
+                                            tag());
+}
+
+template <typename Request, typename Reply>
+void UnaryCallData<Request, Reply>::reset() {
+  if (admitted_) {
+    pool_->admissionController_->release();
+    admitted_ = false;
+  }
+  // Responder refers to the context, so it goes first.
+  responder_.reset();
+  context_.reset();
+  request_ = nullptr;
+  reply_ = nullptr;
+  arena_.Reset();
+  requestKey_.clear();
+  finishedOk_ = false;
+  stageMarks_.fill(0u);
+  cancelled_.store(false, std::memory_order_relaxed);
+  status_ = CallStatus::CREATE;
+}
+
+template <typename Request, typename Reply>
+void UnaryCallData<Request, Reply>::proceed(bool const ok) {
+  if (ok && status_ == CallStatus::PROCESS) {
+    LOG_TRACE("Processing request");
+    mark(Stage::Admit);
+    acceptedAt_ = std::chrono::steady_clock::now();
+    pool_->metrics_->onAccepted(pool_->rpc_);
+    // Arm a pooled slot to serve new clients while we process the one for
+    // this CallData. The slot will return to the pool as part of its FINISH
+    // state.
+    pool_->acquire()->arm();
+
+    // Call has started: wait for the Finish and the done tags.
+    pendingTags_ = 2u;
+
+    // Don't queue work nobody waits for.
+    if (auto const abortStatus = getAbortStatus(); !abortStatus.ok()) {
+      abort(abortStatus);
+      return;
+    }
+
+    if (pool_->responseCache_ != nullptr || pool_->coalescer_ != nullptr) {
+      request_->SerializeToString(&requestKey_);
+    }
+
+    // Serve cached reply right here, without hopping to the event loop.
+    if (auto* responseCache = pool_->responseCache_) {
+      if (auto const cached = responseCache->find(requestKey_);
+          cached != nullptr && reply_->ParseFromString(*cached)) {
+        LOG_TRACE("Reply found in cache");
+        finish();
+        return;
+      }
+    }
+
+    // Fail fast instead of growing the event loop queue when overloaded.
+    if (!pool_->admissionController_->tryAcquire()) {
+      LOG_DEBUG("Too many calls in flight. Shedding request.");
+      finishWithError(grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                                   "Too many calls in flight"));
+      return;
+    }
+    admitted_ = true;
+
+    // Identical call is in flight already. Its leader finishes this one, so
+    // this instance must not be touched anymore.
+    if (pool_->coalescer_ != nullptr &&
+        !pool_->coalescer_->join(requestKey_, this)) {
+      LOG_TRACE("Call coalesced");
+      return;
+    }
+
+    // Handle request in the event loop, in the lane of its priority
+    mark(Stage::Queue);
+    pool_->dispatchQueue_->post(getCallPriority(*context_),
+                                [this]() { handle(); });
+  } else if (status_ == CallStatus::PROCESS) {
+    // Call never started, so the done tag won't come back.
+    pool_->release(this);
+  } else {
+    // CallStatus::FINISH
+    recordStages();
+    pool_->metrics_->onFinished(pool_->rpc_,
+                                ok && finishedOk_,
+                                std::chrono::steady_clock::now() - acceptedAt_);
+    // Once in the FINISH state, return ourselves (CallData) to the pool.
+    onTagDone();
+  }
+}
+
+template <typename Request, typename Reply>
+void UnaryCallData<Request, Reply>::handle() {
+  mark(Stage::Handle);
+  auto* coalescer = pool_->coalescer_;
+  // Call may have died while waiting in the event loop queue. Still the
+  // reply is needed if other calls wait for it.
+  if (auto const abortStatus = getAbortStatus();
+      !abortStatus.ok() &&
+      (coalescer == nullptr || coalescer->tryAbandon(requestKey_))) {
+    abort(abortStatus);
+    return;
+  }
+
+  auto handled =
+      (pool_->serverEventHandler_->*pool_->handleMethod_)(*request_, *reply_);
+  if (handled.isReady()) {
+    // Handler has completed in place, no need for another event loop hop.
+    onHandled(std::move(handled).getTry());
+    return;
+  }
+  // Slot and its reply stay alive until the call is finished. The
+  // continuation goes through the dispatch queue, so in manual mode it
+  // counts against the budget of drain.
+  std::move(handled)
+      .via(&folly::InlineExecutor::instance())
+      .thenTry([this](folly::Try<folly::Unit>&& result) {
+        pool_->dispatchQueue_->runInLoop(
+            getCallPriority(*context_),
+            [this, result = std::move(result)]() { onHandled(result); });
+      });
+}
+
+template <typename Request, typename Reply>
+void UnaryCallData<Request, Reply>::onHandled(
+    folly::Try<folly::Unit> const& result) {
+  mark(Stage::Reply);
+  auto* coalescer = pool_->coalescer_;
+  if (result.hasException()) {
+    LOG_ERRORF("Handler failed: {}", result.exception().what().toStdString());
+    auto const status =
+        grpc::Status(grpc::StatusCode::INTERNAL, "Handler failed");
+    if (coalescer != nullptr) {
+      for (auto* follower : coalescer->complete(requestKey_)) {
+        follower->fail(status);
+      }
+    }
+    fail(status);
+    return;
+  }
+
+  if (auto* responseCache = pool_->responseCache_) {
+    responseCache->insert(requestKey_, reply_->SerializeAsString());
+  }
+  if (coalescer != nullptr) {
+    for (auto* follower : coalescer->complete(requestKey_)) {
+      follower->finishWith(*reply_);
+    }
+  }
+
+  // Skip serialization of the reply if the client has gone meanwhile.
+  if (auto const abortStatus = getAbortStatus(); !abortStatus.ok()) {
+    abort(abortStatus);
+    return;
+  }
+
+  // And we are done! Let the gRPC runtime know we've
+  // finished, using
+  // the memory address of this instance as the uniquely identifying tag
+  // for the event.
+  finish();
+}
+
+template <typename Request, typename Reply>
+void UnaryCallData<Request, Reply>::finishWith(Reply const& reply) {
+  if (auto const abortStatus = getAbortStatus(); !abortStatus.ok()) {
+    abort(abortStatus);
+    return;
+  }
+  reply_->CopyFrom(reply);
+  finish();
+}
+
+template <typename Request, typename Reply>
+void UnaryCallData<Request, Reply>::fail(grpc::Status const& status) {
+  finishWithError(status);
+}
+
+template <typename Request, typename Reply>
+void UnaryCallData<Request, Reply>::finish() {
+  finishedOk_ = true;
+  status_ = CallStatus::FINISH;
+  mark(Stage::Send);
+  serializeTicks_.store(kSerializePending, std::memory_order_relaxed);
+  auto const finishStartedAt = stageMarks_[ToIntegral(Stage::Send)];
+  responder_->Finish(*reply_, grpc::Status::OK, tag());
+  // Slot may be finished by now, only locals and the atomic are safe to
+  // touch.
+  auto pending = kSerializePending;
+  serializeTicks_.compare_exchange_strong(pending,
+                                          CycleClock::now() - finishStartedAt,
+                                          std::memory_order_relaxed);
+}
+
+template <typename Request, typename Reply>
+void UnaryCallData<Request, Reply>::finishWithError(
+    grpc::Status const& status) {
+  status_ = CallStatus::FINISH;
+  mark(Stage::Send);
+  responder_->FinishWithError(status, tag());
+}
+
+template <typename Request, typename Reply>
+void UnaryCallData<Request, Reply>::onDone(bool) {
+  // IsCancelled is safe to call only after the done tag is delivered.
+  if (context_->IsCancelled()) {
+    LOG_TRACE("Call cancelled");
+    cancelled_.store(true, std::memory_order_relaxed);
+  }
+  onTagDone();
+}
+
+template <typename Request, typename Reply>
+void UnaryCallData<Request, Reply>::onTagDone() {
+  assert(pendingTags_ > 0u);
+  if (--pendingTags_ == 0u) {
+    pool_->release(this);
+  }
+}
+
+template <typename Request, typename Reply>
+void UnaryCallData<Request, Reply>::mark(Stage const stage) {
+  stageMarks_[ToIntegral(stage)] = CycleClock::now();
+}
+
+template <typename Request, typename Reply>
+void UnaryCallData<Request, Reply>::recordStages() {
+  // Skipped stages leave zero marks, e.g. cached and shed calls go from
+  // Admit straight to Send. Stage ends where the next passed one starts.
+  auto serializeTicks =
+      serializeTicks_.exchange(kSerializeTaken, std::memory_order_relaxed);
+  if (serializeTicks >= kSerializeTaken) {
+    serializeTicks = 0u;
+  } else {
+    pool_->metrics_->onStage(Stage::Serialize, serializeTicks);
+  }
+  // Taken after the exchange, so Send does not end before Finish returned.
+  auto endedAt = CycleClock::now();
+  for (auto i = stageMarks_.size(); i-- > 0u;) {
+    auto const startedAt = stageMarks_[i];
+    if (startedAt == 0u) {
+      continue;
+    }
+    // Send starts once the Finish call has returned.
+    auto const stageStartedAt = FromIntegral<Stage>(i) == Stage::Send
+                                    ? startedAt + serializeTicks
+                                    : startedAt;
+    if (endedAt >= stageStartedAt) {
+      pool_->metrics_->onStage(FromIntegral<Stage>(i),
+                               endedAt - stageStartedAt);
+    }
+    endedAt = startedAt;
+  }
+}
+
+template <typename Request, typename Reply>
+grpc::Status UnaryCallData<Request, Reply>::getAbortStatus() const {
+  if (cancelled_.load(std::memory_order_relaxed)) {
+    return grpc::Status::CANCELLED;
+  }
+  // Deadline is infinite if the client has not set it.
+  if (context_->deadline() <= std::chrono::system_clock::now()) {
+    return grpc::Status(grpc::StatusCode::DEADLINE_EXCEEDED,
+                        "Deadline exceeded");
+  }
+  return grpc::Status::OK;
+}
+
+template <typename Request, typename Reply>
+void UnaryCallData<Request, Reply>::abort(grpc::Status const& status) {
+  LOG_DEBUGF("Call dropped without handling: {}", status.error_message());
+  pool_->abortedCount_.fetch_add(1u, std::memory_order_relaxed);
+  finishWithError(status);
+}
+
+template <typename Request, typename Reply>
+UnaryCallDataPool<Request, Reply>::UnaryCallDataPool(
+    DispatchQueue* dispatchQueue,
+    Greeter::AsyncService* service,
+    grpc::ServerCompletionQueue* completionQueue,
+    IServerEventHandler* serverEventHandler,
+    typename CallData::RequestMethod requestMethod,
+    typename CallData::HandleMethod handleMethod,
+    AdmissionController* admissionController,
+    ResponseCache* responseCache,
+    Coalescer* coalescer,
+    Metrics* metrics,
+    Rpc rpc,
+    std::size_t initialSize)
+    : dispatchQueue_(dispatchQueue),
+      service_(service),
+      completionQueue_(completionQueue),
+      serverEventHandler_(serverEventHandler),
+      requestMethod_(requestMethod),
+      handleMethod_(handleMethod),
+      admissionController_(admissionController),
+      responseCache_(responseCache),
+      coalescer_(coalescer),
+      metrics_(metrics),
+      rpc_(rpc) {
+  freeSlots_.reserve(initialSize);
+  for (auto i = 0u; i < initialSize; ++i) {
+    freeSlots_.push_back(allocate());
+  }
+}
+
+template <typename Request, typename Reply>
+typename UnaryCallDataPool<Request, Reply>::CallData*
+UnaryCallDataPool<Request, Reply>::acquire() {
+  if (freeSlots_.empty()) {
+    exhaustedCount_.fetch_add(1u, std::memory_order_relaxed);
+    return allocate();
+  }
+  auto* callData = freeSlots_.back();
+  freeSlots_.pop_back();
+  return callData;
+}
+
+template <typename Request, typename Reply>
+typename UnaryCallDataPool<Request, Reply>::CallData*
+UnaryCallDataPool<Request, Reply>::allocate() {
+  slotsCount_.fetch_add(1u, std::memory_order_relaxed);
+  return &slots_.emplace_back(this);
+}
+
+template <typename Request, typename Reply>
+void UnaryCallDataPool<Request, Reply>::release(CallData* callData) {
+  callData->reset();
+  freeSlots_.push_back(callData);
+}
+
+template <typename Request, typename Reply>
+bool UnaryCallDataPool<Request, Reply>::isIdle() const {
+  return freeSlots_.size() == slots_.size();
+}
+
+template <typename Request, typename Reply>
+std::uint64_t UnaryCallDataPool<Request, Reply>::getSlotsCount() const {
+  return slotsCount_.load(std::memory_order_relaxed);
+}
+
+template <typename Request, typename Reply>
+std::uint64_t UnaryCallDataPool<Request, Reply>::getExhaustedCount() const {
+  return exhaustedCount_.load(std::memory_order_relaxed);
+}
+
+template <typename Request, typename Reply>
+std::uint64_t UnaryCallDataPool<Request, Reply>::getAbortedCount() const {
+  return abortedCount_.load(std::memory_order_relaxed);
+}
+
+} // namespace fservice
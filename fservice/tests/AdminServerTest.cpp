@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/AdminServer.h>
+
+#include <protos/Admin.grpc.pb.h>
+
+#include <grpcpp/grpcpp.h>
+
+#include <catch2/catch.hpp>
+#include <trompeloeil.hpp>
+
+#include <string>
+
+namespace fservice {
+
+class AdminEventHandlerMock : public IAdminEventHandler {
+ public:
+  MAKE_MOCK2(onGetStats,
+             void(GetStatsRequest const& request, StatsReply& reply),
+             override);
+  MAKE_MOCK2(onGetConfig,
+             void(GetConfigRequest const& request, ConfigReply& reply),
+             override);
+  MAKE_MOCK2(onResetStats,
+             void(ResetStatsRequest const& request, ResetStatsReply& reply),
+             override);
+};
+
+} // namespace fservice
+
+TEST_CASE("Admin calls served by own thread", "[AdminServer]") {
+  using trompeloeil::_;
+
+  fservice::AdminEventHandlerMock fakeAdminEventHandler;
+  REQUIRE_CALL(fakeAdminEventHandler, onGetStats(_, _))
+      .TIMES(2)
+      .SIDE_EFFECT({
+        _2.set_shed_calls(3u);
+        if (_1.prometheus_text()) {
+          _2.set_prometheus_text("fservice_calls_shed_total 3\n");
+        }
+      });
+  REQUIRE_CALL(fakeAdminEventHandler, onGetConfig(_, _))
+      .SIDE_EFFECT((*_2.mutable_options())["port"] = "12010");
+  REQUIRE_CALL(fakeAdminEventHandler, onResetStats(_, _));
+
+  auto const address = std::string{"127.0.0.1:12010"};
+  fservice::AdminServer server(fakeAdminEventHandler);
+  server.runAsync(address);
+
+  auto stub = fservice::Admin::NewStub(
+      grpc::CreateChannel(address, grpc::InsecureChannelCredentials()));
+  {
+    grpc::ClientContext context;
+    fservice::GetStatsRequest request;
+    fservice::StatsReply reply;
+    REQUIRE(stub->GetStats(&context, request, &reply).ok());
+    REQUIRE(reply.shed_calls() == 3u);
+    REQUIRE(reply.prometheus_text().empty());
+  }
+  {
+    grpc::ClientContext context;
+    fservice::GetStatsRequest request;
+    request.set_prometheus_text(true);
+    fservice::StatsReply reply;
+    REQUIRE(stub->GetStats(&context, request, &reply).ok());
+    REQUIRE(reply.prometheus_text() == "fservice_calls_shed_total 3\n");
+  }
+  {
+    grpc::ClientContext context;
+    fservice::ConfigReply reply;
+    REQUIRE(stub->GetConfig(&context, {}, &reply).ok());
+    REQUIRE(reply.options().at("port") == "12010");
+  }
+  {
+    grpc::ClientContext context;
+    fservice::ResetStatsReply reply;
+    REQUIRE(stub->ResetStats(&context, {}, &reply).ok());
+  }
+
+  server.shutdown();
+}
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/AdmissionController.h>
+
+#include <catch2/catch.hpp>
+
+TEST_CASE("Unlimited controller admits all", "[AdmissionController]") {
+  fservice::AdmissionController controller{0u};
+  for (int i = 0; i < 100; ++i) {
+    REQUIRE(controller.tryAcquire());
+  }
+  REQUIRE(controller.getInFlight() == 100u);
+  REQUIRE(controller.getAccepted() == 100u);
+  REQUIRE(controller.getShed() == 0u);
+}
+
+TEST_CASE("Calls over the limit are shed", "[AdmissionController]") {
+  fservice::AdmissionController controller{2u};
+  REQUIRE(controller.tryAcquire());
+  REQUIRE(controller.tryAcquire());
+  REQUIRE(!controller.tryAcquire());
+  REQUIRE(controller.getInFlight() == 2u);
+
+  controller.release();
+  REQUIRE(controller.tryAcquire());
+  REQUIRE(controller.getAccepted() == 3u);
+  REQUIRE(controller.getShed() == 1u);
+}
+
+TEST_CASE("Parent limit applies to children", "[AdmissionController]") {
+  fservice::AdmissionController global{3u};
+  fservice::AdmissionController first{2u, &global};
+  fservice::AdmissionController second{2u, &global};
+
+  REQUIRE(first.tryAcquire());
+  REQUIRE(first.tryAcquire());
+  REQUIRE(!first.tryAcquire());
+  REQUIRE(second.tryAcquire());
+  REQUIRE(!second.tryAcquire());
+  REQUIRE(global.getInFlight() == 3u);
+  REQUIRE(second.getInFlight() == 1u);
+
+  first.release();
+  REQUIRE(global.getInFlight() == 2u);
+  REQUIRE(second.tryAcquire());
+  REQUIRE(second.getShed() == 1u);
+}
@@ -3,16 +3,27 @@
 // Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
 
 #include <fservice/AsyncServer.h>
+#include <fservice/EnumUtil.h>
 #include <fservice/GeneralError.h>
 #include <fservice/Logger.h>
 #include <fservice/tests/IServerEventHandlerMock.h>
+#include <fservice/tests/ServerTestUtil.h>
 #include <fservice/tests/SyncClient.h>
 
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/futures/Future.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/EventBaseManager.h>
 
 #include <catch2/catch.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
 DECLARE_GLOBAL_GET_LOGGER("ServerTest")
 
 TEST_CASE("Sync request and Async response", "[AsyncServer]") {
@@ -26,25 +37,633 @@ TEST_CASE("Sync request and Async response", "[AsyncServer]") {
 
   auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
   auto const address = std::string{"127.0.0.1:12001"};
-  auto server = fservice::AsyncServer(*eventLoop, fakeServerEventHandler);
+  auto server = fservice::AsyncServer({eventLoop}, fakeServerEventHandler);
   server.runAsync(address);
 
-  auto clientThread = std::thread([address = std::move(address), eventLoop]() {
-    auto client = fservice::SyncClient(
-        grpc::CreateChannel(address, grpc::InsecureChannelCredentials()));
+  fservice::runWithClient(*eventLoop, [&address]() {
+    auto client = fservice::makeSyncClient(address);
+    fservice::checkSayHello(client, 5);
+  });
+}
+
+TEST_CASE("Requests served by multiple completion queues", "[AsyncServer]") {
+  using trompeloeil::_;
+
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  ALLOW_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    _2.set_message("Hello " + _1.name());
+  });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  fservice::ServerConfig config;
+  config.queuesCount = 4u;
+  auto server =
+      fservice::AsyncServer({eventLoop}, fakeServerEventHandler, config);
+  server.runAsync(address);
+
+  fservice::runWithClients(*eventLoop, 4, [&address](int clientId) {
+    auto client = fservice::makeSyncClient(address);
     for (int i = 1; i <= 5; ++i) {
-      auto const user = std::string{"world " + std::to_string(i)};
+      auto const user = fmt::format("client {} world {}", clientId, i);
       auto const replyOrError = client.SayHello(user);
       REQUIRE(replyOrError.hasValue());
       REQUIRE(replyOrError.value() == "Hello " + user);
     }
-    // eventLoop->runInEventBaseThread(
-    //    [eventLoop]() { eventLoop->terminateLoopSoon(); });
-    eventLoop->terminateLoopSoon();
   });
+}
 
-  eventLoop->loopForever();
+TEST_CASE("Requests served with busy polling", "[AsyncServer]") {
+  using trompeloeil::_;
+
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  ALLOW_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    _2.set_message("Hello " + _1.name());
+  });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  fservice::ServerConfig config;
+  config.busyPollSpin = std::chrono::milliseconds(1);
+  auto server =
+      fservice::AsyncServer({eventLoop}, fakeServerEventHandler, config);
+  server.runAsync(address);
+
+  fservice::runWithClient(*eventLoop, [&address]() {
+    auto client = fservice::makeSyncClient(address);
+    fservice::checkSayHello(client, 5);
+  });
+  auto const stats = server.getStats();
+  REQUIRE(stats.queueSpinTimeUs > 0u);
+  REQUIRE(stats.queueCpuTimeUs > 0u);
+}
+
+TEST_CASE("Requests served in ticks", "[AsyncServer]") {
+  using trompeloeil::_;
+
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  ALLOW_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    _2.set_message("Hello " + _1.name());
+  });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  fservice::ServerConfig config;
+  config.manualDispatch = true;
+  auto server =
+      fservice::AsyncServer({eventLoop}, fakeServerEventHandler, config);
+  server.runAsync(address);
+
+  std::atomic_bool done = false;
+  auto clientThread = std::thread([&address, &done]() {
+    auto client = fservice::makeSyncClient(address);
+    fservice::checkSayHello(client, 5);
+    done = true;
+  });
+
+  // Calls are run by processEvents only, one per tick here.
+  while (!done) {
+    eventLoop->loopOnce(EVLOOP_NONBLOCK);
+    std::size_t budget = 1u;
+    server.processEvents(budget, std::chrono::steady_clock::now());
+  }
   clientThread.join();
+  auto const stats = server.getStats();
+  REQUIRE(stats.lanes[1].dispatched == 5u);
+}
+
+TEST_CASE("Calls are dispatched by x-priority metadata", "[AsyncServer]") {
+  using trompeloeil::_;
+
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  ALLOW_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    _2.set_message("Hello " + _1.name());
+  });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  auto server = fservice::AsyncServer({eventLoop}, fakeServerEventHandler);
+  server.runAsync(address);
+
+  fservice::runWithClient(*eventLoop, [&address]() {
+    auto stub = fservice::makeStub(address);
+    // Unknown and missing priority are normal.
+    for (auto const* priority : {"high", "low", "low", "urgent", ""}) {
+      grpc::ClientContext context;
+      if (*priority != '\0') {
+        context.AddMetadata("x-priority", priority);
+      }
+      REQUIRE(fservice::callSayHello(*stub, context, "world").ok());
+    }
+  });
+  auto const stats = server.getStats();
+  REQUIRE(stats.lanes[0].dispatched == 1u);
+  REQUIRE(stats.lanes[1].dispatched == 2u);
+  REQUIRE(stats.lanes[2].dispatched == 2u);
+}
+
+TEST_CASE("Pre-posted calls are allocated up front", "[AsyncServer]") {
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  fservice::ServerConfig config;
+  config.queuesCount = 2u;
+  config.prepostCount = 4u;
+  auto server =
+      fservice::AsyncServer({eventLoop}, fakeServerEventHandler, config);
+  server.runAsync("127.0.0.1:12001");
+
+  // Pools of SayHello and SayHelloBatch hold backlog and as many calls in
+  // process.
+  auto const stats = server.getStats();
+  REQUIRE(stats.callDataSlots ==
+          config.queuesCount * 2u * 2u * config.prepostCount);
+  REQUIRE(stats.callDataPoolExhausted == 0u);
+}
+
+TEST_CASE("Calls over in-flight limit are shed", "[AsyncServer]") {
+  using trompeloeil::_;
+
+  std::promise<void> handlerEntered;
+  std::promise<void> handlerReleased;
+  auto released = handlerReleased.get_future();
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  // Shed calls never reach the handler.
+  REQUIRE_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    handlerEntered.set_value();
+    released.wait();
+    _2.set_message("Hello " + _1.name());
+  });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  fservice::ServerConfig config;
+  config.maxInFlight = 1u;
+  auto server =
+      fservice::AsyncServer({eventLoop}, fakeServerEventHandler, config);
+  server.runAsync(address);
+
+  auto const extraCallsCount = 3;
+  fservice::runWithClients(*eventLoop, 2, [&](int clientId) {
+    if (clientId == 0) {
+      auto client = fservice::makeSyncClient(address);
+      auto const replyOrError = client.SayHello("world");
+      REQUIRE(replyOrError.hasValue());
+      return;
+    }
+    // The only slot is held by the blocked handler.
+    handlerEntered.get_future().wait();
+    auto stub = fservice::makeStub(address);
+    for (int i = 0; i < extraCallsCount; ++i) {
+      grpc::ClientContext context;
+      auto const status = fservice::callSayHello(*stub, context, "extra");
+      REQUIRE(status.error_code() == grpc::StatusCode::RESOURCE_EXHAUSTED);
+    }
+    handlerReleased.set_value();
+  });
+
+  auto const stats = server.getStats();
+  REQUIRE(stats.acceptedCalls == 1u);
+  REQUIRE(stats.shedCalls == static_cast<std::uint64_t>(extraCallsCount));
+}
+
+TEST_CASE("Throwing handler fails the call", "[AsyncServer]") {
+  using trompeloeil::_;
+
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  REQUIRE_CALL(fakeServerEventHandler, onSayHello(_, _))
+      .THROW(std::runtime_error("Handler error"));
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  auto server = fservice::AsyncServer({eventLoop}, fakeServerEventHandler);
+  server.runAsync(address);
+
+  fservice::runWithClient(*eventLoop, [&address]() {
+    auto stub = fservice::makeStub(address);
+    grpc::ClientContext context;
+    auto const status = fservice::callSayHello(*stub, context, "world");
+    REQUIRE(status.error_code() == grpc::StatusCode::INTERNAL);
+  });
+}
+
+TEST_CASE("Call expired while queued is not handled", "[AsyncServer]") {
+  using trompeloeil::_;
+
+  std::promise<void> handlerEntered;
+  std::promise<void> handlerReleased;
+  auto released = handlerReleased.get_future();
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  // Only the first call reaches the handler. It blocks the event loop, so
+  // the second one waits in the queue until its deadline passes.
+  REQUIRE_CALL(fakeServerEventHandler, onSayHello(_, _))
+      .WITH(_1.name() == "first")
+      .SIDE_EFFECT({
+        handlerEntered.set_value();
+        released.wait();
+        _2.set_message("Hello " + _1.name());
+      });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  auto server = fservice::AsyncServer({eventLoop}, fakeServerEventHandler);
+  server.runAsync(address);
+
+  fservice::runWithClients(*eventLoop, 2, [&](int clientId) {
+    if (clientId == 0) {
+      auto client = fservice::makeSyncClient(address);
+      REQUIRE(client.SayHello("first").hasValue());
+      return;
+    }
+    handlerEntered.get_future().wait();
+    auto stub = fservice::makeStub(address);
+    grpc::ClientContext context;
+    context.set_deadline(std::chrono::system_clock::now() +
+                         std::chrono::milliseconds(200));
+    auto const status = fservice::callSayHello(*stub, context, "second");
+    REQUIRE(status.error_code() == grpc::StatusCode::DEADLINE_EXCEEDED);
+    REQUIRE(server.getStats().acceptedCalls == 2u);
+    handlerReleased.set_value();
+    // Dropped once the event loop gets to it.
+    REQUIRE(fservice::waitFor(
+        [&server]() { return server.getStats().abortedCalls == 1u; }));
+  });
+}
+
+TEST_CASE("Call cancelled while queued is not handled", "[AsyncServer]") {
+  using trompeloeil::_;
+
+  std::promise<void> handlerEntered;
+  std::promise<void> handlerReleased;
+  auto released = handlerReleased.get_future();
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  REQUIRE_CALL(fakeServerEventHandler, onSayHello(_, _))
+      .WITH(_1.name() == "first")
+      .SIDE_EFFECT({
+        handlerEntered.set_value();
+        released.wait();
+        _2.set_message("Hello " + _1.name());
+      });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  auto server = fservice::AsyncServer({eventLoop}, fakeServerEventHandler);
+  server.runAsync(address);
+
+  fservice::runWithClients(*eventLoop, 2, [&](int clientId) {
+    if (clientId == 0) {
+      auto client = fservice::makeSyncClient(address);
+      REQUIRE(client.SayHello("first").hasValue());
+      return;
+    }
+    handlerEntered.get_future().wait();
+    auto stub = fservice::makeStub(address);
+    grpc::ClientContext context;
+    // Cancel once the server has queued the call.
+    auto canceller = std::thread([&server, &context]() {
+      REQUIRE(fservice::waitFor(
+          [&server]() { return server.getStats().acceptedCalls == 2u; }));
+      context.TryCancel();
+    });
+    auto const status = fservice::callSayHello(*stub, context, "second");
+    canceller.join();
+    REQUIRE(status.error_code() == grpc::StatusCode::CANCELLED);
+    handlerReleased.set_value();
+    REQUIRE(fservice::waitFor(
+        [&server]() { return server.getStats().abortedCalls == 1u; }));
+  });
+}
+
+TEST_CASE("Bidirectional stream with completion queues", "[AsyncServer]") {
+  using trompeloeil::_;
+
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  ALLOW_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    _2.set_message("Hello " + _1.name());
+  });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  fservice::ServerConfig config;
+  config.streamMaxPendingReplies = 4u;
+  auto server =
+      fservice::AsyncServer({eventLoop}, fakeServerEventHandler, config);
+  server.runAsync(address);
+
+  fservice::runWithClient(*eventLoop, [&address]() {
+    auto client = fservice::makeSyncClient(address);
+    std::vector<std::string> users;
+    for (int i = 1; i <= 50; ++i) {
+      users.push_back("world " + std::to_string(i));
+    }
+    auto const repliesOrError = client.SayHelloStream(users);
+    REQUIRE(repliesOrError.hasValue());
+    REQUIRE(repliesOrError.value().size() == users.size());
+    for (auto i = 0u; i < users.size(); ++i) {
+      REQUIRE(repliesOrError.value()[i] == "Hello " + users[i]);
+    }
+  });
+}
+
+TEST_CASE("Batch request with completion queues", "[AsyncServer]") {
+  using trompeloeil::_;
+
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  ALLOW_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    _2.set_message("Hello " + _1.name());
+  });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  auto server = fservice::AsyncServer({eventLoop}, fakeServerEventHandler);
+  server.runAsync(address);
+
+  fservice::runWithClient(*eventLoop, [&address]() {
+    auto client = fservice::makeSyncClient(address);
+    std::vector<std::string> users;
+    for (int i = 1; i <= 10; ++i) {
+      users.push_back("world " + std::to_string(i));
+    }
+    auto const repliesOrError = client.SayHelloBatch(users);
+    REQUIRE(repliesOrError.hasValue());
+    REQUIRE(repliesOrError.value().size() == users.size());
+    for (auto i = 0u; i < users.size(); ++i) {
+      REQUIRE(repliesOrError.value()[i] == "Hello " + users[i]);
+    }
+  });
+}
+
+TEST_CASE("Unary calls served in raw mode", "[AsyncServer]") {
+  using trompeloeil::_;
+
+  // Default onRawCall parses messages and calls the typed handlers.
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  ALLOW_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    _2.set_message("Hello " + _1.name());
+  });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  fservice::ServerConfig config;
+  config.rawMode = true;
+  auto server =
+      fservice::AsyncServer({eventLoop}, fakeServerEventHandler, config);
+  server.runAsync(address);
+
+  fservice::runWithClient(*eventLoop, [&address]() {
+    auto client = fservice::makeSyncClient(address);
+    auto const replyOrError = client.SayHello("world");
+    REQUIRE(replyOrError.hasValue());
+    REQUIRE(replyOrError.value() == "Hello world");
+
+    auto const users = std::vector<std::string>{"first", "second"};
+    auto const repliesOrError = client.SayHelloBatch(users);
+    REQUIRE(repliesOrError.hasValue());
+    REQUIRE(repliesOrError.value() ==
+            std::vector<std::string>{"Hello first", "Hello second"});
+  });
+}
+
+TEST_CASE("Raw call expired while queued is not handled", "[AsyncServer]") {
+  using trompeloeil::_;
+
+  std::promise<void> handlerEntered;
+  std::promise<void> handlerReleased;
+  auto released = handlerReleased.get_future();
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  REQUIRE_CALL(fakeServerEventHandler, onSayHello(_, _))
+      .WITH(_1.name() == "first")
+      .SIDE_EFFECT({
+        handlerEntered.set_value();
+        released.wait();
+        _2.set_message("Hello " + _1.name());
+      });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  fservice::ServerConfig config;
+  config.rawMode = true;
+  auto server =
+      fservice::AsyncServer({eventLoop}, fakeServerEventHandler, config);
+  server.runAsync(address);
+
+  fservice::runWithClients(*eventLoop, 2, [&](int clientId) {
+    if (clientId == 0) {
+      auto client = fservice::makeSyncClient(address);
+      REQUIRE(client.SayHello("first").hasValue());
+      return;
+    }
+    handlerEntered.get_future().wait();
+    auto stub = fservice::makeStub(address);
+    grpc::ClientContext context;
+    context.set_deadline(std::chrono::system_clock::now() +
+                         std::chrono::milliseconds(200));
+    auto const status = fservice::callSayHello(*stub, context, "second");
+    REQUIRE(status.error_code() == grpc::StatusCode::DEADLINE_EXCEEDED);
+    handlerReleased.set_value();
+    // Dropped once the event loop gets to it.
+    REQUIRE(fservice::waitFor(
+        [&server]() { return server.getStats().abortedCalls == 1u; }));
+  });
+}
+
+TEST_CASE("Stages of cached call keep admission", "[AsyncServer]") {
+  using fservice::Stage;
+  using trompeloeil::_;
+
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  REQUIRE_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    _2.set_message("Hello " + _1.name());
+  });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  fservice::ServerConfig config;
+  config.cacheCapacity = 16u;
+  auto server =
+      fservice::AsyncServer({eventLoop}, fakeServerEventHandler, config);
+  server.runAsync(address);
+
+  fservice::runWithClient(*eventLoop, [&address, &server]() {
+    auto client = fservice::makeSyncClient(address);
+    REQUIRE(client.SayHello("world").hasValue());
+    REQUIRE(client.SayHello("world").hasValue());
+    auto const getCount = [&server](Stage stage) {
+      return server.getStats().stages[fservice::ToIntegral(stage)].getCount();
+    };
+    // Stages are counted once the Finish tag is back.
+    REQUIRE(fservice::waitFor(
+        [&getCount]() { return getCount(Stage::Send) == 2u; }));
+    REQUIRE(getCount(Stage::Admit) == 2u);
+    REQUIRE(getCount(Stage::Queue) == 1u);
+    REQUIRE(getCount(Stage::Handle) == 1u);
+    REQUIRE(getCount(Stage::Reply) == 1u);
+  });
+}
+
+TEST_CASE("Cached reply is served without handler", "[AsyncServer]") {
+  using trompeloeil::_;
+
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  // Only the first call reaches the handler.
+  REQUIRE_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    _2.set_message("Hello " + _1.name());
+  });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  fservice::ServerConfig config;
+  config.cacheCapacity = 16u;
+  auto server =
+      fservice::AsyncServer({eventLoop}, fakeServerEventHandler, config);
+  server.runAsync(address);
+
+  fservice::runWithClient(*eventLoop, [&address]() {
+    auto client = fservice::makeSyncClient(address);
+    for (int i = 0; i < 3; ++i) {
+      auto const replyOrError = client.SayHello("world");
+      REQUIRE(replyOrError.hasValue());
+      REQUIRE(replyOrError.value() == "Hello world");
+    }
+  });
+  auto const stats = server.getStats();
+  REQUIRE(stats.cacheMisses == 1u);
+  REQUIRE(stats.cacheHits == 2u);
+}
+
+TEST_CASE("Identical calls in flight are handled once", "[AsyncServer]") {
+  using trompeloeil::_;
+
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  fservice::ServerConfig config;
+  config.queuesCount = 2u;
+  config.prepostCount = 4u;
+  config.coalesceRequests = true;
+  auto server =
+      fservice::AsyncServer({eventLoop}, fakeServerEventHandler, config);
+  server.runAsync(address);
+
+  auto const clientsCount = 4;
+  std::atomic_int handledCount{0};
+  ALLOW_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    ++handledCount;
+    // Hold the call until the calls of all other clients joined it.
+    REQUIRE(fservice::waitFor([&server]() {
+      return server.getStats().coalescedCalls == clientsCount - 1u;
+    }));
+    _2.set_message("Hello " + _1.name());
+  });
+
+  fservice::runWithClients(*eventLoop, clientsCount, [&address](int) {
+    auto client = fservice::makeSyncClient(address);
+    auto const replyOrError = client.SayHello("world");
+    REQUIRE(replyOrError.hasValue());
+    REQUIRE(replyOrError.value() == "Hello world");
+  });
+  REQUIRE(handledCount == 1);
+  REQUIRE(server.getStats().coalescedCalls == clientsCount - 1u);
+}
+
+TEST_CASE("Shutdown lets calls in flight finish", "[AsyncServer]") {
+  using trompeloeil::_;
+
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  auto server = fservice::AsyncServer({eventLoop}, fakeServerEventHandler);
+  server.runAsync(address);
+
+  std::thread shutdownThread;
+  REQUIRE_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    // Drain starts while the call is being handled.
+    shutdownThread = std::thread(
+        [&server]() { server.shutdown(std::chrono::seconds(5)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    _2.set_message("Hello " + _1.name());
+  });
+
+  fservice::runWithClient(*eventLoop, [&address]() {
+    auto client = fservice::makeSyncClient(address);
+    auto const replyOrError = client.SayHello("world");
+    REQUIRE(replyOrError.hasValue());
+    REQUIRE(replyOrError.value() == "Hello world");
+  });
+  shutdownThread.join();
+}
+
+TEST_CASE("Servers share address with SO_REUSEPORT", "[AsyncServer]") {
+  using trompeloeil::_;
+
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  ALLOW_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    _2.set_message("Hello " + _1.name());
+  });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  fservice::ServerConfig config;
+  config.transport.reusePort = true;
+  auto first =
+      fservice::AsyncServer({eventLoop}, fakeServerEventHandler, config);
+  auto second =
+      fservice::AsyncServer({eventLoop}, fakeServerEventHandler, config);
+  first.runAsync(address);
+  second.runAsync(address);
+
+  // Separate connections, so the kernel spreads them over both servers.
+  // All of them land on one server with probability 2^-15.
+  auto const clientsCount = 16;
+  fservice::runWithClients(
+      *eventLoop, clientsCount, [&address](int clientId) {
+        auto client = fservice::makeSyncClient(address);
+        auto const user = fmt::format("client {}", clientId);
+        auto const replyOrError = client.SayHello(user);
+        REQUIRE(replyOrError.hasValue());
+        REQUIRE(replyOrError.value() == "Hello " + user);
+      });
+
+  auto const firstAccepted = first.getStats().acceptedCalls;
+  auto const secondAccepted = second.getStats().acceptedCalls;
+  REQUIRE(firstAccepted > 0u);
+  REQUIRE(secondAccepted > 0u);
+  REQUIRE(firstAccepted + secondAccepted ==
+          static_cast<std::uint64_t>(clientsCount));
+}
+
+TEST_CASE("Async handler completes on another executor", "[AsyncServer]") {
+  using trompeloeil::_;
+
+  // Fills the reply on its own thread, off the event loop.
+  struct CpuServerEventHandler : public fservice::ServerEventHandlerMock {
+    folly::SemiFuture<folly::Unit> onSayHelloAsync(
+        fservice::HelloRequest const& request,
+        fservice::HelloReply& reply) override {
+      return folly::via(folly::getKeepAliveToken(cpuThreadPool),
+                        [this, &request, &reply]() {
+                          onSayHello(request, reply);
+                        })
+          .semi();
+    }
+
+    folly::CPUThreadPoolExecutor cpuThreadPool{1u};
+  };
+
+  CpuServerEventHandler fakeServerEventHandler;
+  ALLOW_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    _2.set_message("Hello " + _1.name());
+  });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  auto server = fservice::AsyncServer({eventLoop}, fakeServerEventHandler);
+  server.runAsync(address);
+
+  fservice::runWithClient(*eventLoop, [&address]() {
+    auto client = fservice::makeSyncClient(address);
+    fservice::checkSayHello(client, 5);
+  });
 }
 
 TEST_CASE("Client connect when no server available", "[AsyncServer]") {
@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/CallbackServer.h>
+#include <fservice/Logger.h>
+#include <fservice/tests/IServerEventHandlerMock.h>
+#include <fservice/tests/ServerTestUtil.h>
+#include <fservice/tests/SyncClient.h>
+
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventBaseManager.h>
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+DECLARE_GLOBAL_GET_LOGGER("CallbackServerTest")
+
+TEST_CASE("Sync request and callback response", "[CallbackServer]") {
+  using trompeloeil::_;
+
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  ALLOW_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    LOG_INFOF("Server got request: {}", _1.name());
+    _2.set_message("Hello " + _1.name());
+  });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  auto server = fservice::CallbackServer({eventLoop}, fakeServerEventHandler);
+  server.runAsync(address);
+
+  fservice::runWithClient(*eventLoop, [&address]() {
+    auto client = fservice::makeSyncClient(address);
+    fservice::checkSayHello(client, 5);
+  });
+}
+
+TEST_CASE("Bidirectional stream with reactor", "[CallbackServer]") {
+  using trompeloeil::_;
+
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  ALLOW_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    _2.set_message("Hello " + _1.name());
+  });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  fservice::ServerConfig config;
+  config.streamMaxPendingReplies = 4u;
+  auto server =
+      fservice::CallbackServer({eventLoop}, fakeServerEventHandler, config);
+  server.runAsync(address);
+
+  fservice::runWithClient(*eventLoop, [&address]() {
+    auto client = fservice::makeSyncClient(address);
+    std::vector<std::string> users;
+    for (int i = 1; i <= 50; ++i) {
+      users.push_back("world " + std::to_string(i));
+    }
+    auto const repliesOrError = client.SayHelloStream(users);
+    REQUIRE(repliesOrError.hasValue());
+    REQUIRE(repliesOrError.value().size() == users.size());
+    for (auto i = 0u; i < users.size(); ++i) {
+      REQUIRE(repliesOrError.value()[i] == "Hello " + users[i]);
+    }
+  });
+}
+
+TEST_CASE("Batch request with reactor", "[CallbackServer]") {
+  using trompeloeil::_;
+
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  ALLOW_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    _2.set_message("Hello " + _1.name());
+  });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  auto server = fservice::CallbackServer({eventLoop}, fakeServerEventHandler);
+  server.runAsync(address);
+
+  fservice::runWithClient(*eventLoop, [&address]() {
+    auto client = fservice::makeSyncClient(address);
+    std::vector<std::string> users;
+    for (int i = 1; i <= 10; ++i) {
+      users.push_back("world " + std::to_string(i));
+    }
+    auto const repliesOrError = client.SayHelloBatch(users);
+    REQUIRE(repliesOrError.hasValue());
+    REQUIRE(repliesOrError.value().size() == users.size());
+    for (auto i = 0u; i < users.size(); ++i) {
+      REQUIRE(repliesOrError.value()[i] == "Hello " + users[i]);
+    }
+  });
+}
+
+TEST_CASE("Call expired while handled gets no reply", "[CallbackServer]") {
+  using trompeloeil::_;
+
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  // Handler outlives the deadline of the call.
+  REQUIRE_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    _2.set_message("Hello " + _1.name());
+  });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  auto server = fservice::CallbackServer({eventLoop}, fakeServerEventHandler);
+  server.runAsync(address);
+
+  fservice::runWithClient(*eventLoop, [&address, &server]() {
+    auto stub = fservice::makeStub(address);
+    grpc::ClientContext context;
+    context.set_deadline(std::chrono::system_clock::now() +
+                         std::chrono::milliseconds(100));
+    auto const status = fservice::callSayHello(*stub, context, "late");
+    REQUIRE(status.error_code() == grpc::StatusCode::DEADLINE_EXCEEDED);
+    REQUIRE(fservice::waitFor(
+        [&server]() { return server.getStats().abortedCalls == 1u; }));
+  });
+}
@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/CoroUtil.h>
+
+#if FOLLY_HAS_COROUTINES
+
+#include <fservice/AsyncServer.h>
+#include <fservice/tests/IServerEventHandlerMock.h>
+#include <fservice/tests/ServerTestUtil.h>
+
+#include <folly/experimental/coro/BlockingWait.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventBaseManager.h>
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+folly::coro::Task<void> sleepAndMark(folly::HHWheelTimer& timer,
+                                     bool& woken) {
+  co_await fservice::sleepFor(timer, std::chrono::milliseconds(20));
+  woken = true;
+}
+
+folly::coro::Task<void> mark(bool& done) {
+  done = true;
+  co_return;
+}
+
+/* Handler which suspends calls of user "slow" on a timer. */
+class SleepingEventHandler final : public fservice::IServerEventHandler {
+ public:
+  void onSayHello(fservice::HelloRequest const& request,
+                  fservice::HelloReply& reply) override {
+    reply.set_message("Hello " + request.name());
+  }
+
+  folly::SemiFuture<folly::Unit> onSayHelloAsync(
+      fservice::HelloRequest const& request,
+      fservice::HelloReply& reply) override {
+    return fservice::startHandler(coSayHello(request, reply), nullptr);
+  }
+
+  std::atomic_bool slowSuspended{false};
+
+ private:
+  folly::coro::Task<void> coSayHello(fservice::HelloRequest const& request,
+                                     fservice::HelloReply& reply) {
+    if (request.name() == "slow") {
+      // Event loop serves other calls until the timer fires.
+      auto* eventLoop = folly::EventBaseManager::get()->getExistingEventBase();
+      slowSuspended = true;
+      co_await fservice::sleepFor(eventLoop->timer(),
+                                  std::chrono::milliseconds(200));
+    }
+    onSayHello(request, reply);
+  }
+};
+
+} // namespace
+
+TEST_CASE("Coroutine sleeps without blocking event loop", "[CoroUtil]") {
+  folly::EventBase eventLoop;
+  auto woken = false;
+  auto otherTaskRun = false;
+  auto const startedAt = std::chrono::steady_clock::now();
+  auto done = fservice::startHandler(sleepAndMark(eventLoop.timer(), woken),
+                                     &eventLoop);
+  eventLoop.runInEventBaseThread([&]() { otherTaskRun = true; });
+
+  while (!done.isReady()) {
+    eventLoop.loopOnce();
+  }
+
+  REQUIRE(woken);
+  REQUIRE(otherTaskRun);
+  REQUIRE(std::chrono::steady_clock::now() - startedAt >=
+          std::chrono::milliseconds(20));
+}
+
+TEST_CASE("Coroutine which does not suspend completes inline",
+          "[CoroUtil]") {
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto done = false;
+  auto completed = fservice::startHandler(mark(done), eventLoop);
+  REQUIRE(done);
+  REQUIRE(completed.isReady());
+}
+
+TEST_CASE("Suspended handler does not hold other calls", "[CoroUtil]") {
+  SleepingEventHandler sleepingEventHandler;
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  auto server = fservice::AsyncServer({eventLoop}, sleepingEventHandler);
+  server.runAsync(address);
+
+  std::mutex finishedMutex;
+  std::vector<std::string> finished;
+  fservice::runWithClients(*eventLoop, 2, [&](int clientId) {
+    auto client = fservice::makeSyncClient(address);
+    auto const user = clientId == 0 ? std::string{"slow"} : "fast";
+    if (clientId == 1) {
+      REQUIRE(fservice::waitFor([&sleepingEventHandler]() {
+        return sleepingEventHandler.slowSuspended.load();
+      }));
+    }
+    auto const replyOrError = client.SayHello(user);
+    REQUIRE(replyOrError.hasValue());
+    REQUIRE(replyOrError.value() == "Hello " + user);
+    std::lock_guard<std::mutex> const lock(finishedMutex);
+    finished.push_back(user);
+  });
+  REQUIRE(finished == std::vector<std::string>{"fast", "slow"});
+}
+
+TEST_CASE("Coroutine awaits outbound call", "[CoroUtil]") {
+  using trompeloeil::_;
+
+  fservice::ServerEventHandlerMock fakeServerEventHandler;
+  ALLOW_CALL(fakeServerEventHandler, onSayHello(_, _)).SIDE_EFFECT({
+    _2.set_message("Hello " + _1.name());
+  });
+
+  auto* eventLoop = folly::EventBaseManager::get()->getEventBase();
+  auto const address = std::string{"127.0.0.1:12001"};
+  auto server = fservice::AsyncServer({eventLoop}, fakeServerEventHandler);
+  server.runAsync(address);
+
+  auto clientThread = std::thread([address, eventLoop]() {
+    auto const stub = fservice::Greeter::NewStub(
+        grpc::CreateChannel(address, grpc::InsecureChannelCredentials()));
+    grpc::ClientContext context;
+    fservice::HelloRequest request;
+    request.set_name("world");
+    fservice::HelloReply reply;
+    auto const status = folly::coro::blockingWait(
+        fservice::callSayHello(*stub, context, request, reply));
+    REQUIRE(status.ok());
+    REQUIRE(reply.message() == "Hello world");
+    eventLoop->terminateLoopSoon();
+  });
+
+  eventLoop->loopForever();
+  clientThread.join();
+}
+
+#endif // FOLLY_HAS_COROUTINES
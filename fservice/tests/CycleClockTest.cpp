@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/CycleClock.h>
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <thread>
+
+TEST_CASE("Cycle clock ticks convert to elapsed time", "[CycleClock]") {
+  using fservice::CycleClock;
+  using namespace std::chrono_literals;
+  CycleClock::calibrate();
+
+  auto const startTicks = CycleClock::now();
+  auto const startedAt = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(20ms);
+  auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - startedAt);
+  auto const ticks = CycleClock::now() - startTicks;
+
+  auto const measured = CycleClock::toNanoseconds(ticks);
+  REQUIRE(measured >= 19'000'000u);
+  // Rate is calibrated within a few percent.
+  REQUIRE(static_cast<double>(measured) <= elapsed.count() * 1.1);
+}
@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/DispatchQueue.h>
+
+#include <folly/io/async/EventBase.h>
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Lanes are drained by weight", "[DispatchQueue]") {
+  using fservice::Priority;
+  folly::EventBase eventLoop;
+  auto const dispatchQueue = std::make_shared<fservice::DispatchQueue>(
+      &eventLoop, fservice::DispatchQueue::Weights{2u, 1u, 1u}, 16u);
+
+  std::vector<Priority> order;
+  auto const post = [&](Priority priority) {
+    dispatchQueue->post(priority,
+                        [&order, priority]() { order.push_back(priority); });
+  };
+  post(Priority::Low);
+  post(Priority::Normal);
+  post(Priority::Normal);
+  post(Priority::High);
+  post(Priority::High);
+  post(Priority::High);
+  REQUIRE(dispatchQueue->getLaneStats(Priority::High).depth == 3u);
+
+  eventLoop.loopOnce();
+
+  REQUIRE(order == std::vector<Priority>{Priority::High,
+                                         Priority::High,
+                                         Priority::Normal,
+                                         Priority::Low,
+                                         Priority::High,
+                                         Priority::Normal});
+  auto const stats = dispatchQueue->getLaneStats(Priority::High);
+  REQUIRE(stats.depth == 0u);
+  REQUIRE(stats.dispatched == 3u);
+}
+
+TEST_CASE("Wait lasts until the task starts", "[DispatchQueue]") {
+  using fservice::Priority;
+  folly::EventBase eventLoop;
+  auto const dispatchQueue = std::make_shared<fservice::DispatchQueue>(
+      &eventLoop, fservice::DispatchQueue::Weights{1u, 1u, 1u}, 16u);
+
+  // Second task of the batch waits for the first one.
+  dispatchQueue->post(Priority::Normal, []() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  });
+  dispatchQueue->post(Priority::Normal, []() {});
+  eventLoop.loopOnce();
+
+  auto const stats = dispatchQueue->getLaneStats(Priority::Normal);
+  REQUIRE(stats.dispatched == 2u);
+  REQUIRE(stats.maxWaitTimeUs >= 20000u);
+}
+
+TEST_CASE("Full lane keeps order of overflowed tasks", "[DispatchQueue]") {
+  using fservice::Priority;
+  folly::EventBase eventLoop;
+  auto const dispatchQueue = std::make_shared<fservice::DispatchQueue>(
+      &eventLoop, fservice::DispatchQueue::Weights{1u, 1u, 1u}, 1u);
+
+  std::vector<int> order;
+  for (auto i = 0; i < 3; ++i) {
+    dispatchQueue->post(Priority::Normal,
+                        [&order, i]() { order.push_back(i); });
+  }
+  auto stats = dispatchQueue->getLaneStats(Priority::Normal);
+  REQUIRE(stats.overflowed == 2u);
+  REQUIRE(stats.depth == 3u);
+  eventLoop.loopOnce();
+
+  REQUIRE(order == std::vector<int>{0, 1, 2});
+  stats = dispatchQueue->getLaneStats(Priority::Normal);
+  REQUIRE(stats.dispatched == 3u);
+  REQUIRE(stats.depth == 0u);
+  auto const batchSizes = dispatchQueue->getBatchSizes();
+  REQUIRE(batchSizes[1] == 1u);
+}
+
+TEST_CASE("Overflowed tasks obey drain budget", "[DispatchQueue]") {
+  using fservice::Priority;
+  folly::EventBase eventLoop;
+  auto const dispatchQueue = std::make_shared<fservice::DispatchQueue>(
+      &eventLoop, fservice::DispatchQueue::Weights{1u, 1u, 1u}, 1u, true);
+
+  auto runCount = 0u;
+  for (auto i = 0; i < 3; ++i) {
+    dispatchQueue->post(Priority::Normal, [&runCount]() { ++runCount; });
+  }
+  eventLoop.loopOnce();
+  REQUIRE(runCount == 0u);
+
+  auto const deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  std::size_t budget = 2u;
+  REQUIRE(dispatchQueue->drain(budget, deadline));
+  REQUIRE(runCount == 2u);
+  budget = 2u;
+  REQUIRE_FALSE(dispatchQueue->drain(budget, deadline));
+  REQUIRE(runCount == 3u);
+}
+
+TEST_CASE("Manual queue is drained within budget", "[DispatchQueue]") {
+  using fservice::Priority;
+  folly::EventBase eventLoop;
+  auto const dispatchQueue = std::make_shared<fservice::DispatchQueue>(
+      &eventLoop, fservice::DispatchQueue::Weights{1u, 1u, 1u}, 16u, true);
+
+  auto runCount = 0u;
+  for (auto i = 0; i < 5; ++i) {
+    dispatchQueue->post(Priority::Normal, [&runCount]() { ++runCount; });
+  }
+  eventLoop.loopOnce();
+  REQUIRE(runCount == 0u);
+
+  auto const deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  std::size_t budget = 3u;
+  REQUIRE(dispatchQueue->drain(budget, deadline));
+  REQUIRE(runCount == 3u);
+  REQUIRE(budget == 0u);
+
+  budget = 3u;
+  REQUIRE_FALSE(dispatchQueue->drain(budget, deadline));
+  REQUIRE(runCount == 5u);
+  REQUIRE(budget == 1u);
+}
+
+TEST_CASE("Manual queue runs loop tasks within budget", "[DispatchQueue]") {
+  using fservice::Priority;
+  folly::EventBase eventLoop;
+  auto const dispatchQueue = std::make_shared<fservice::DispatchQueue>(
+      &eventLoop, fservice::DispatchQueue::Weights{1u, 1u, 1u}, 16u, true);
+
+  auto runCount = 0u;
+  for (auto i = 0; i < 3; ++i) {
+    dispatchQueue->runInLoop(Priority::Normal, [&runCount]() { ++runCount; });
+  }
+  eventLoop.loopOnce();
+  REQUIRE(runCount == 0u);
+
+  auto const deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  std::size_t budget = 2u;
+  REQUIRE(dispatchQueue->drain(budget, deadline));
+  REQUIRE(runCount == 2u);
+}
+
+TEST_CASE("Drain without budget runs nothing", "[DispatchQueue]") {
+  using fservice::Priority;
+  folly::EventBase eventLoop;
+  auto const dispatchQueue = std::make_shared<fservice::DispatchQueue>(
+      &eventLoop, fservice::DispatchQueue::Weights{1u, 1u, 1u}, 16u, true);
+
+  auto const deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  std::size_t budget = 0u;
+  REQUIRE_FALSE(dispatchQueue->drain(budget, deadline));
+
+  auto runCount = 0u;
+  dispatchQueue->post(Priority::Normal, [&runCount]() { ++runCount; });
+  REQUIRE(dispatchQueue->drain(budget, deadline));
+  REQUIRE(runCount == 0u);
+
+  budget = 1u;
+  dispatchQueue->drain(budget, deadline);
+  REQUIRE(runCount == 1u);
+}
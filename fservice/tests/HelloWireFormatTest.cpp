@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/HelloWireFormat.h>
+
+#include <protos/Greeter.pb.h>
+
+#include <catch2/catch.hpp>
+
+#include <grpcpp/impl/codegen/proto_utils.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+grpc::ByteBuffer toByteBuffer(std::string const& bytes) {
+  grpc::Slice slice(bytes);
+  return grpc::ByteBuffer(&slice, 1u);
+}
+
+std::string toString(grpc::ByteBuffer const& buffer) {
+  std::vector<grpc::Slice> slices;
+  REQUIRE(buffer.Dump(&slices).ok());
+  std::string bytes;
+  for (auto const& slice : slices) {
+    bytes.append(reinterpret_cast<char const*>(slice.begin()), slice.size());
+  }
+  return bytes;
+}
+
+std::string serializeRequest(std::string const& name) {
+  fservice::HelloRequest request;
+  request.set_name(name);
+  return request.SerializeAsString();
+}
+
+} // namespace
+
+TEST_CASE("Method names match generated service", "[HelloWireFormat]") {
+  REQUIRE(fservice::getSayHelloMethodName() == "/fservice.Greeter/SayHello");
+  REQUIRE(fservice::getSayHelloBatchMethodName() ==
+          "/fservice.Greeter/SayHelloBatch");
+}
+
+TEST_CASE("Name is read from request", "[HelloWireFormat]") {
+  auto request = toByteBuffer(serializeRequest("alice"));
+  std::string name;
+  REQUIRE(fservice::readHelloRequestName(request, name));
+  REQUIRE(name == "alice");
+}
+
+TEST_CASE("Empty request has empty name", "[HelloWireFormat]") {
+  auto request = toByteBuffer(std::string{});
+  std::string name;
+  REQUIRE(fservice::readHelloRequestName(request, name));
+  REQUIRE(name.empty());
+}
+
+TEST_CASE("Unknown fields are skipped", "[HelloWireFormat]") {
+  // Field 2 varint 150, field 3 fixed32, then name, then field 4 string.
+  auto const bytes = std::string{"\x10\x96\x01", 3u} +
+                     std::string{"\x1d\x01\x02\x03\x04", 5u} +
+                     serializeRequest("alice") + std::string{"\x22\x01x", 3u};
+  auto request = toByteBuffer(bytes);
+  std::string name;
+  REQUIRE(fservice::readHelloRequestName(request, name));
+  REQUIRE(name == "alice");
+}
+
+TEST_CASE("Last repeated name wins", "[HelloWireFormat]") {
+  auto const bytes = serializeRequest("alice") + serializeRequest("bob");
+  fservice::HelloRequest parsed;
+  REQUIRE(parsed.ParseFromString(bytes));
+
+  auto request = toByteBuffer(bytes);
+  std::string name;
+  REQUIRE(fservice::readHelloRequestName(request, name));
+  REQUIRE(name == parsed.name());
+}
+
+TEST_CASE("Truncated request is rejected", "[HelloWireFormat]") {
+  auto bytes = serializeRequest("alice");
+  std::string name;
+  SECTION("Truncated name") {
+    bytes.pop_back();
+  }
+  SECTION("Truncated length") {
+    bytes = std::string{"\x0a", 1u};
+  }
+  SECTION("Truncated tag") {
+    bytes = std::string{"\x96", 1u};
+  }
+  auto request = toByteBuffer(bytes);
+  REQUIRE_FALSE(fservice::readHelloRequestName(request, name));
+}
+
+TEST_CASE("Malformed request is rejected", "[HelloWireFormat]") {
+  std::string bytes;
+  SECTION("Zero field number") {
+    bytes = std::string{"\x00\x01", 2u};
+  }
+  SECTION("Invalid wire type") {
+    bytes = std::string{"\x0f\x01", 2u};
+  }
+  SECTION("End group without start") {
+    bytes = std::string{"\x0c", 1u};
+  }
+  SECTION("Length beyond message") {
+    bytes = std::string{"\x0a\xff\xff\xff\xff\x0f", 6u};
+  }
+  auto request = toByteBuffer(bytes);
+  std::string name;
+  REQUIRE_FALSE(fservice::readHelloRequestName(request, name));
+}
+
+TEST_CASE("Reply is parsed by protobuf", "[HelloWireFormat]") {
+  auto const name = std::string(300u, 'a');
+  auto const reply = fservice::makeHelloReply("Hello ", name);
+  fservice::HelloReply parsed;
+  REQUIRE(parsed.ParseFromString(toString(reply)));
+  REQUIRE(parsed.message() == "Hello " + name);
+}
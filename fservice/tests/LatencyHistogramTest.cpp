@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/LatencyHistogram.h>
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+
+TEST_CASE("Histogram buckets bound relative error", "[LatencyHistogram]") {
+  using fservice::LatencyHistogram;
+  REQUIRE(LatencyHistogram::getBucketIndex(0u) == 0u);
+  REQUIRE(LatencyHistogram::getBucketIndex(15u) == 15u);
+  REQUIRE(LatencyHistogram::getBucketIndex(16u) == 16u);
+  REQUIRE(LatencyHistogram::getBucketIndex(~std::uint64_t{0u}) ==
+          LatencyHistogram::kBucketsCount - 1u);
+
+  for (std::uint64_t value = 1u; value < (1u << 20u); value = value * 3u + 1u) {
+    auto const index = LatencyHistogram::getBucketIndex(value);
+    auto const upperBound = LatencyHistogram::getBucketUpperBound(index);
+    REQUIRE(upperBound >= value);
+    REQUIRE(upperBound - value <= value / LatencyHistogram::kSubBuckets);
+    if (index > 0u) {
+      REQUIRE(LatencyHistogram::getBucketUpperBound(index - 1u) < value);
+    }
+  }
+}
+
+TEST_CASE("Histogram percentiles", "[LatencyHistogram]") {
+  fservice::LatencyHistogram histogram;
+  REQUIRE(histogram.getPercentile(50.0) == 0u);
+  REQUIRE(histogram.getMax() == 0u);
+
+  for (std::uint64_t value = 1u; value <= 100u; ++value) {
+    histogram.record(value);
+  }
+  REQUIRE(histogram.getCount() == 100u);
+  REQUIRE(histogram.getPercentile(0.0) == 1u);
+  REQUIRE(histogram.getPercentile(50.0) == 51u);
+  REQUIRE(histogram.getPercentile(99.0) == 99u);
+  REQUIRE(histogram.getMax() == 103u);
+}
+
+TEST_CASE("Histogram difference keeps newer values", "[LatencyHistogram]") {
+  fservice::LatencyHistogram earlier;
+  earlier.record(5u);
+  earlier.record(1000u);
+  auto later = earlier;
+  later.record(7u);
+
+  later -= earlier;
+  REQUIRE(later.getCount() == 1u);
+  REQUIRE(later.getMax() == 7u);
+
+  later += earlier;
+  REQUIRE(later.getCount() == 3u);
+}
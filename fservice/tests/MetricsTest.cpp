@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/CycleClock.h>
+#include <fservice/EnumUtil.h>
+#include <fservice/Metrics.h>
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Metrics sum shards of all threads", "[Metrics]") {
+  using fservice::Rpc;
+  using namespace std::chrono_literals;
+  fservice::Metrics metrics;
+
+  metrics.onAccepted(Rpc::SayHello);
+  // Counters of exited threads are kept.
+  std::vector<std::thread> threads;
+  for (auto i = 0; i < 4; ++i) {
+    threads.emplace_back([&metrics]() {
+      metrics.onAccepted(Rpc::SayHello);
+      metrics.onFinished(Rpc::SayHello, true, 100us);
+      metrics.onAccepted(Rpc::SayHelloBatch);
+      metrics.onFinished(Rpc::SayHelloBatch, false, 3ms);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto const snapshot = metrics.getSnapshot();
+  auto const& hello = snapshot[fservice::ToIntegral(Rpc::SayHello)];
+  REQUIRE(hello.accepted == 5u);
+  REQUIRE(hello.completed == 4u);
+  REQUIRE(hello.failed == 0u);
+  REQUIRE(hello.getInFlight() == 1u);
+  REQUIRE(hello.latency.getCount() == 4u);
+  REQUIRE(hello.latency.getPercentile(50.0) >= 100u);
+  REQUIRE(hello.latency.getPercentile(50.0) < 107u);
+
+  auto const& batch = snapshot[fservice::ToIntegral(Rpc::SayHelloBatch)];
+  REQUIRE(batch.accepted == 4u);
+  REQUIRE(batch.failed == 4u);
+  REQUIRE(batch.getInFlight() == 0u);
+  REQUIRE(batch.latency.getMax() >= 3000u);
+}
+
+TEST_CASE("Metrics interval is difference of snapshots", "[Metrics]") {
+  using fservice::Rpc;
+  using namespace std::chrono_literals;
+  fservice::Metrics metrics;
+
+  metrics.onAccepted(Rpc::Raw);
+  metrics.onFinished(Rpc::Raw, true, 5ms);
+  auto const earlier = metrics.getSnapshot();
+  metrics.onAccepted(Rpc::Raw);
+  metrics.onFinished(Rpc::Raw, true, 10us);
+
+  auto interval = metrics.getSnapshot()[fservice::ToIntegral(Rpc::Raw)];
+  interval -= earlier[fservice::ToIntegral(Rpc::Raw)];
+  REQUIRE(interval.accepted == 1u);
+  REQUIRE(interval.completed == 1u);
+  REQUIRE(interval.latency.getCount() == 1u);
+  REQUIRE(interval.latency.getMax() == 10u);
+}
+
+TEST_CASE("Metrics add to existing snapshot", "[Metrics]") {
+  using fservice::Rpc;
+  using namespace std::chrono_literals;
+  fservice::Metrics first;
+  fservice::Metrics second;
+
+  first.onAccepted(Rpc::SayHello);
+  second.onAccepted(Rpc::SayHello);
+  second.onFinished(Rpc::SayHello, true, 20us);
+
+  fservice::Metrics::Snapshot snapshot;
+  first.addSnapshot(snapshot);
+  second.addSnapshot(snapshot);
+  auto const& hello = snapshot[fservice::ToIntegral(Rpc::SayHello)];
+  REQUIRE(hello.accepted == 2u);
+  REQUIRE(hello.completed == 1u);
+  REQUIRE(hello.latency.getCount() == 1u);
+}
+
+TEST_CASE("Calls in flight are not negative", "[Metrics]") {
+  fservice::RpcMetrics rpcMetrics;
+  rpcMetrics.accepted = 3u;
+  rpcMetrics.completed = 1u;
+  REQUIRE(rpcMetrics.getInFlight() == 2u);
+
+  // Snapshot taken between the reads of accepted and completed.
+  rpcMetrics.completed = 2u;
+  rpcMetrics.failed = 2u;
+  REQUIRE(rpcMetrics.getInFlight() == 0u);
+}
+
+TEST_CASE("Metrics count stage latencies in nanoseconds", "[Metrics]") {
+  using fservice::Stage;
+  using namespace std::chrono_literals;
+  fservice::Metrics metrics;
+
+  auto const startTicks = fservice::CycleClock::now();
+  std::this_thread::sleep_for(2ms);
+  metrics.onStage(Stage::Queue, fservice::CycleClock::now() - startTicks);
+  metrics.onStage(Stage::Queue, 0u);
+  std::thread([&metrics]() { metrics.onStage(Stage::Send, 0u); }).join();
+
+  auto const snapshot = metrics.getStagesSnapshot();
+  auto const& queue = snapshot[fservice::ToIntegral(Stage::Queue)];
+  REQUIRE(queue.getCount() == 2u);
+  REQUIRE(queue.getPercentile(0.0) == 0u);
+  REQUIRE(queue.getMax() >= 2'000'000u);
+  REQUIRE(queue.getMax() < 1'000'000'000u);
+  REQUIRE(snapshot[fservice::ToIntegral(Stage::Send)].getCount() == 1u);
+  REQUIRE(snapshot[fservice::ToIntegral(Stage::Handle)].getCount() == 0u);
+}
@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/PrometheusFormat.h>
+
+#include <protos/Admin.pb.h>
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+TEST_CASE("Stats rendered in Prometheus format", "[PrometheusFormat]") {
+  fservice::StatsReply stats;
+  auto& rpc = *stats.add_rpcs();
+  rpc.set_method("SayHello");
+  rpc.set_accepted(10u);
+  rpc.set_completed(8u);
+  rpc.set_in_flight(2u);
+  rpc.mutable_latency()->set_count(8u);
+  rpc.mutable_latency()->set_p99_us(120u);
+  auto& lane = *stats.add_lanes();
+  lane.set_priority("high");
+  lane.set_depth(3u);
+  stats.set_shed_calls(4u);
+
+  auto const text = fservice::formatPrometheus(stats);
+  auto const contains = [&text](std::string const& line) {
+    return text.find(line + "\n") != std::string::npos;
+  };
+  REQUIRE(contains("# TYPE fservice_calls_accepted_total counter"));
+  REQUIRE(contains("fservice_calls_accepted_total{method=\"SayHello\"} 10"));
+  REQUIRE(contains("fservice_calls_in_flight{method=\"SayHello\"} 2"));
+  REQUIRE(contains("fservice_call_latency_microseconds"
+                   "{method=\"SayHello\",quantile=\"0.99\"} 120"));
+  REQUIRE(contains("# TYPE fservice_call_latency_microseconds gauge"));
+  REQUIRE(contains("fservice_calls_shed_total 4"));
+  REQUIRE(contains("fservice_lane_depth{priority=\"high\"} 3"));
+}
@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/QueuePoller.h>
+
+#include <grpcpp/alarm.h>
+#include <grpcpp/grpcpp.h>
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <thread>
+
+namespace {
+
+int eventTag = 0;
+
+} // namespace
+
+TEST_CASE("Busy poll picks up events without parking", "[QueuePoller]") {
+  grpc::CompletionQueue completionQueue;
+  fservice::QueuePoller poller{
+      &completionQueue, std::chrono::milliseconds(100), true};
+  poller.bindCurrentThread();
+
+  grpc::Alarm alarm;
+  alarm.Set(&completionQueue,
+            std::chrono::system_clock::now() + std::chrono::milliseconds(5),
+            &eventTag);
+  void* tag = nullptr;
+  auto ok = false;
+  REQUIRE(poller.next(&tag, &ok));
+  REQUIRE(tag == &eventTag);
+  REQUIRE(ok);
+  REQUIRE(poller.getSpinHits() == 1u);
+  REQUIRE(poller.getParks() == 0u);
+  REQUIRE(poller.getSpinTimeUs() > 0u);
+  REQUIRE(poller.getCpuTimeUs() > 0u);
+
+  completionQueue.Shutdown();
+  REQUIRE(!poller.next(&tag, &ok));
+}
+
+TEST_CASE("Busy poll parks after spin time", "[QueuePoller]") {
+  grpc::CompletionQueue completionQueue;
+  fservice::QueuePoller poller{
+      &completionQueue, std::chrono::microseconds(100), true};
+
+  grpc::Alarm alarm;
+  alarm.Set(&completionQueue,
+            std::chrono::system_clock::now() + std::chrono::milliseconds(50),
+            &eventTag);
+  void* tag = nullptr;
+  auto ok = false;
+  REQUIRE(poller.next(&tag, &ok));
+  REQUIRE(tag == &eventTag);
+  REQUIRE(poller.getSpinHits() == 0u);
+  REQUIRE(poller.getParks() == 1u);
+
+  completionQueue.Shutdown();
+  REQUIRE(!poller.next(&tag, &ok));
+}
+
+TEST_CASE("CPU time is kept after the polling thread exits", "[QueuePoller]") {
+  grpc::CompletionQueue completionQueue;
+  fservice::QueuePoller poller{
+      &completionQueue, std::chrono::microseconds(0), true};
+
+  std::thread([&poller]() {
+    poller.bindCurrentThread();
+    auto const startedAt = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - startedAt <
+           std::chrono::milliseconds(5)) {
+    }
+    poller.unbindCurrentThread();
+  }).join();
+
+  auto const cpuTimeUs = poller.getCpuTimeUs();
+  REQUIRE(cpuTimeUs > 0u);
+  REQUIRE(poller.getCpuTimeUs() == cpuTimeUs);
+}
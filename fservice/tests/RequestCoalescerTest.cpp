@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/RequestCoalescer.h>
+
+#include <catch2/catch.hpp>
+
+namespace {
+
+struct FakeCall {};
+
+} // namespace
+
+TEST_CASE("Identical requests wait for the leader", "[RequestCoalescer]") {
+  fservice::RequestCoalescer<FakeCall> coalescer;
+  FakeCall leader, first, second, other;
+
+  REQUIRE(coalescer.join("alice", &leader));
+  REQUIRE(!coalescer.join("alice", &first));
+  REQUIRE(!coalescer.join("alice", &second));
+  REQUIRE(coalescer.join("bob", &other));
+
+  auto const followers = coalescer.complete("alice");
+  REQUIRE(followers == std::vector<FakeCall*>{&first, &second});
+  REQUIRE(coalescer.getCoalesced() == 2u);
+
+  // Key is released, next call leads again.
+  REQUIRE(coalescer.join("alice", &leader));
+}
+
+TEST_CASE("Leader may give up only without followers", "[RequestCoalescer]") {
+  fservice::RequestCoalescer<FakeCall> coalescer;
+  FakeCall leader, follower;
+
+  REQUIRE(coalescer.join("alice", &leader));
+  REQUIRE(coalescer.tryAbandon("alice"));
+  REQUIRE(coalescer.join("alice", &leader));
+
+  REQUIRE(!coalescer.join("alice", &follower));
+  REQUIRE(!coalescer.tryAbandon("alice"));
+  REQUIRE(coalescer.complete("alice") == std::vector<FakeCall*>{&follower});
+}
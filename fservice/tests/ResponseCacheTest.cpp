@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/ResponseCache.h>
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+TEST_CASE("Cached reply is found", "[ResponseCache]") {
+  fservice::ResponseCache cache{16u, std::chrono::milliseconds(0), 4u};
+  REQUIRE(cache.find("alice") == nullptr);
+
+  cache.insert("alice", "Hello alice");
+  auto const value = cache.find("alice");
+  REQUIRE(value != nullptr);
+  REQUIRE(*value == "Hello alice");
+  REQUIRE(cache.getHits() == 1u);
+  REQUIRE(cache.getMisses() == 1u);
+}
+
+TEST_CASE("Least recently used reply is evicted", "[ResponseCache]") {
+  fservice::ResponseCache cache{2u, std::chrono::milliseconds(0), 1u};
+  cache.insert("alice", "Hello alice");
+  cache.insert("bob", "Hello bob");
+  REQUIRE(cache.find("alice") != nullptr);
+
+  cache.insert("carol", "Hello carol");
+  REQUIRE(cache.find("bob") == nullptr);
+  REQUIRE(cache.find("alice") != nullptr);
+  REQUIRE(cache.find("carol") != nullptr);
+  REQUIRE(cache.getEvictions() == 1u);
+}
+
+TEST_CASE("Expired reply is not served", "[ResponseCache]") {
+  fservice::ResponseCache cache{16u, std::chrono::milliseconds(1), 1u};
+  cache.insert("alice", "Hello alice");
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  REQUIRE(cache.find("alice") == nullptr);
+  REQUIRE(cache.getMisses() == 1u);
+}
+
+TEST_CASE("Shards together do not exceed capacity", "[ResponseCache]") {
+  auto const keysCount = 100u;
+  auto capacity = 0u;
+  auto shardsCount = 0u;
+  SECTION("Capacity is not divisible by shards count") {
+    capacity = 5u;
+    shardsCount = 4u;
+  }
+  SECTION("Capacity is below shards count") {
+    capacity = 2u;
+    shardsCount = 8u;
+  }
+  fservice::ResponseCache cache{
+      capacity, std::chrono::milliseconds(0), shardsCount};
+  for (auto i = 0u; i < keysCount; ++i) {
+    cache.insert(std::to_string(i), "Hello");
+  }
+  REQUIRE(cache.getEvictions() == keysCount - capacity);
+}
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/tests/ServerTestUtil.h>
+
+#include <folly/io/async/EventBase.h>
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace fservice {
+
+namespace {
+
+std::shared_ptr<grpc::Channel> makeChannel(std::string const& address) {
+  // Channels with the same arguments share connections by default, so
+  // separate clients would land on the same listener.
+  grpc::ChannelArguments arguments;
+  arguments.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+  return grpc::CreateCustomChannel(
+      address, grpc::InsecureChannelCredentials(), arguments);
+}
+
+} // namespace
+
+SyncClient makeSyncClient(std::string const& address) {
+  return SyncClient(makeChannel(address));
+}
+
+std::unique_ptr<Greeter::Stub> makeStub(std::string const& address) {
+  return Greeter::NewStub(makeChannel(address));
+}
+
+grpc::Status callSayHello(Greeter::Stub& stub,
+                          grpc::ClientContext& context,
+                          std::string const& user) {
+  HelloRequest request;
+  request.set_name(user);
+  HelloReply reply;
+  return stub.SayHello(&context, request, &reply);
+}
+
+void runWithClients(folly::EventBase& eventLoop,
+                    int const clientsCount,
+                    std::function<void(int clientId)> const& client) {
+  std::atomic_int finishedClients{0};
+  std::vector<std::thread> clientThreads;
+  for (int clientId = 0; clientId < clientsCount; ++clientId) {
+    clientThreads.emplace_back([&, clientId]() {
+      client(clientId);
+      if (++finishedClients == clientsCount) {
+        eventLoop.terminateLoopSoon();
+      }
+    });
+  }
+
+  eventLoop.loopForever();
+  for (auto& clientThread : clientThreads) {
+    clientThread.join();
+  }
+}
+
+void runWithClient(folly::EventBase& eventLoop,
+                   std::function<void()> const& client) {
+  runWithClients(eventLoop, 1, [&client](int) { client(); });
+}
+
+bool waitFor(std::function<bool()> const& condition) {
+  auto const deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+void checkSayHello(SyncClient& client, int const count) {
+  for (int i = 1; i <= count; ++i) {
+    auto const user = "world " + std::to_string(i);
+    auto const replyOrError = client.SayHello(user);
+    REQUIRE(replyOrError.hasValue());
+    REQUIRE(replyOrError.value() == "Hello " + user);
+  }
+}
+
+} // namespace fservice
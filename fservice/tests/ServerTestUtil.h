@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#pragma once
+
+#include <fservice/tests/SyncClient.h>
+
+#include <protos/Greeter.grpc.pb.h>
+
+#include <grpcpp/grpcpp.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace folly {
+
+class EventBase;
+
+} // namespace folly
+
+namespace fservice {
+
+/**
+ * Create client connected to address over its own channel and connection.
+ */
+SyncClient makeSyncClient(std::string const& address);
+
+/**
+ * Create stub connected to address, for calls whose status or context
+ * matter.
+ */
+std::unique_ptr<Greeter::Stub> makeStub(std::string const& address);
+
+/**
+ * Send SayHello for user and return status of the call.
+ */
+grpc::Status callSayHello(Greeter::Stub& stub,
+                          grpc::ClientContext& context,
+                          std::string const& user);
+
+/**
+ * Run clients in their own threads while the calling thread runs the event
+ * loop. Loop is terminated once the last client returns.
+ * @param client Body of client thread, gets client id from 0 to
+ * clientsCount - 1.
+ */
+void runWithClients(folly::EventBase& eventLoop,
+                    int clientsCount,
+                    std::function<void(int clientId)> const& client);
+
+/**
+ * Run one client, see runWithClients.
+ */
+void runWithClient(folly::EventBase& eventLoop,
+                   std::function<void()> const& client);
+
+/**
+ * Poll condition until it holds, up to a few seconds.
+ * @return True if the condition holds.
+ */
+bool waitFor(std::function<bool()> const& condition);
+
+/**
+ * Send SayHello for users "world 1" to "world <count>" and check the
+ * replies.
+ */
+void checkSayHello(SyncClient& client, int count);
+
+} // namespace fservice
@@ -36,4 +36,56 @@ folly::Expected<std::string, std::error_code> SyncClient::SayHello(
   }
 }
 
+folly::Expected<std::vector<std::string>, std::error_code>
+SyncClient::SayHelloBatch(std::vector<std::string> const& users) {
+  HelloBatchRequest request;
+  for (auto const& user : users) {
+    request.add_requests()->set_name(user);
+  }
+
+  HelloBatchReply reply;
+  grpc::ClientContext context;
+  auto const status = stub_->SayHelloBatch(&context, request, &reply);
+  if (!status.ok()) {
+    LOG_ERRORF("Error: {}:{}", status.error_code(), status.error_message());
+    return folly::makeUnexpected(make_error_code(GeneralError::RpcFailed));
+  }
+
+  std::vector<std::string> messages;
+  for (auto const& item : reply.replies()) {
+    messages.push_back(item.message());
+  }
+  return messages;
+}
+
+folly::Expected<std::vector<std::string>, std::error_code>
+SyncClient::SayHelloStream(std::vector<std::string> const& users) {
+  grpc::ClientContext context;
+  auto stream = stub_->SayHelloStream(&context);
+
+  for (auto const& user : users) {
+    LOG_TRACEF("Sending: {}", user);
+    HelloRequest request;
+    request.set_name(user);
+    if (!stream->Write(request)) {
+      break;
+    }
+  }
+  stream->WritesDone();
+
+  std::vector<std::string> messages;
+  HelloReply reply;
+  while (stream->Read(&reply)) {
+    messages.push_back(reply.message());
+  }
+
+  auto const status = stream->Finish();
+  if (status.ok()) {
+    return messages;
+  } else {
+    LOG_ERRORF("Error: {}:{}", status.error_code(), status.error_message());
+    return folly::makeUnexpected(make_error_code(GeneralError::RpcFailed));
+  }
+}
+
 } // namespace fservice
\ No newline at end of file
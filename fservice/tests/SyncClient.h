@@ -11,6 +11,7 @@
 #include <folly/Expected.h>
 
 #include <atomic>
+#include <vector>
 
 #include <grpcpp/grpcpp.h>
 
@@ -28,6 +29,14 @@ class SyncClient final {
   folly::Expected<std::string, std::error_code> SayHello(
       std::string const& user);
 
+  /* Sends all users in one batch request. */
+  folly::Expected<std::vector<std::string>, std::error_code> SayHelloBatch(
+      std::vector<std::string> const& users);
+
+  /* Sends all users over one stream, then reads all replies. */
+  folly::Expected<std::vector<std::string>, std::error_code> SayHelloStream(
+      std::vector<std::string> const& users);
+
  private:
   DECLARE_GET_LOGGER("SyncClient")
 
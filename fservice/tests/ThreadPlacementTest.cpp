@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/ThreadPlacement.h>
+
+#include <catch2/catch.hpp>
+
+#include <sched.h>
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::vector<std::uint32_t> getCurrentThreadCores() {
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  REQUIRE(sched_getaffinity(0, sizeof(cpuSet), &cpuSet) == 0);
+  std::vector<std::uint32_t> cores;
+  for (auto core = 0u; core < CPU_SETSIZE; ++core) {
+    if (CPU_ISSET(core, &cpuSet)) {
+      cores.push_back(core);
+    }
+  }
+  return cores;
+}
+
+} // namespace
+
+TEST_CASE("Core list is parsed", "[ThreadPlacement]") {
+  using Cores = std::vector<std::uint32_t>;
+  REQUIRE(fservice::parseCoreList("").empty());
+  REQUIRE(fservice::parseCoreList("3") == Cores{3u});
+  REQUIRE(fservice::parseCoreList("0-3,8, 10-11") ==
+          Cores{0u, 1u, 2u, 3u, 8u, 10u, 11u});
+}
+
+TEST_CASE("Malformed core list is rejected", "[ThreadPlacement]") {
+  REQUIRE_THROWS_AS(fservice::parseCoreList("a"), std::invalid_argument);
+  REQUIRE_THROWS_AS(fservice::parseCoreList("3-1"), std::invalid_argument);
+  REQUIRE_THROWS_AS(fservice::parseCoreList("1-2-3"), std::invalid_argument);
+  REQUIRE_THROWS_AS(fservice::parseCoreList("0,,1"), std::invalid_argument);
+}
+
+TEST_CASE("Thread is pinned to the core of its index", "[ThreadPlacement]") {
+  auto const processCores = getCurrentThreadCores();
+  REQUIRE(!processCores.empty());
+  auto const cores =
+      std::vector<std::uint32_t>{processCores.front(), processCores.back()};
+  std::vector<std::uint32_t> threadCores;
+  std::thread([&cores, &threadCores]() {
+    fservice::pinCurrentThread(cores, 3u, false);
+    threadCores = getCurrentThreadCores();
+  }).join();
+  REQUIRE(threadCores == std::vector<std::uint32_t>{cores[1]});
+}
+
+TEST_CASE("Thread without cores is not confined by its spawner",
+          "[ThreadPlacement]") {
+  auto const processCores = getCurrentThreadCores();
+  REQUIRE(!processCores.empty());
+  std::vector<std::uint32_t> threadCores;
+  std::thread([&processCores, &threadCores]() {
+    fservice::pinCurrentThread({processCores.front()}, 0u, false);
+    std::thread([&threadCores]() {
+      fservice::pinCurrentThread({}, 0u, false);
+      threadCores = getCurrentThreadCores();
+    }).join();
+  }).join();
+  REQUIRE(threadCores == processCores);
+}
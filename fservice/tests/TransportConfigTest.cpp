@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: MIT
+
+// Copyright (C) 2020 Malinovsky Rodion (rodionmalino@gmail.com)
+
+#include <fservice/TransportConfig.h>
+
+#include <grpcpp/generic/async_generic_service.h>
+#include <grpcpp/grpcpp.h>
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+TEST_CASE("Transport options must fit int", "[TransportConfig]") {
+  auto constexpr maxInt =
+      static_cast<std::uint32_t>(std::numeric_limits<int>::max());
+  fservice::TransportConfig config;
+  REQUIRE_NOTHROW(fservice::validateTransportConfig(config));
+
+  config.maxFrameSize = maxInt;
+  config.keepaliveTime = std::chrono::milliseconds(maxInt);
+  REQUIRE_NOTHROW(fservice::validateTransportConfig(config));
+
+  SECTION("Size over int") {
+    config.maxReceiveMessageSize = maxInt + 1u;
+    REQUIRE_THROWS_AS(fservice::validateTransportConfig(config),
+                      std::invalid_argument);
+  }
+  SECTION("Time over int") {
+    config.keepaliveTimeout = std::chrono::milliseconds(
+        std::numeric_limits<std::uint32_t>::max());
+    REQUIRE_THROWS_AS(fservice::validateTransportConfig(config),
+                      std::invalid_argument);
+  }
+}
+
+TEST_CASE("Transport options applied to server", "[TransportConfig]") {
+  fservice::TransportConfig config;
+  config.maxConcurrentStreams = 16u;
+  config.streamWindowBytes = 1u << 20u;
+  config.keepaliveTime = std::chrono::seconds(10);
+  config.maxReceiveMessageSize = 1u << 20u;
+  config.quotaMemory = 64u << 20u;
+  config.quotaThreads = 8u;
+  // Clamped instead of wrapping to a negative argument.
+  config.maxSendMessageSize = std::numeric_limits<std::uint32_t>::max();
+
+  grpc::ServerBuilder builder;
+  auto port = 0;
+  builder.AddListeningPort(
+      "127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+  grpc::AsyncGenericService service;
+  builder.RegisterAsyncGenericService(&service);
+  auto completionQueue = builder.AddCompletionQueue();
+  fservice::applyTransportConfig(config, builder);
+  auto server = builder.BuildAndStart();
+  REQUIRE(server != nullptr);
+  REQUIRE(port > 0);
+
+  server->Shutdown();
+  completionQueue->Shutdown();
+  void* tag = nullptr;
+  auto ok = false;
+  while (completionQueue->Next(&tag, &ok)) {
+  }
+}